@@ -0,0 +1,34 @@
+#!/bin/sh
+# Times each bench/NAME.in through the calculator and prints the wall clock seconds of
+# each run. If bench/NAME.n exists, each of its lines is a size that replaces $n in the
+# input, one run per size; if bench/NAME.args exists, each of its lines is a set of
+# command line options, one run per set. Inputs must end with 'q' as in tests/, and
+# what the calculator writes is discarded, so check a new input by running it by hand.
+# Comparisons are separate inputs for the same work, such as NAME_double.in, so give
+# their names together to read the times side by side. Needs GNU date.
+#
+# usage: run_bench.sh path/to/calculator [NAME...]
+
+calculator=${1:?usage: run_bench.sh path/to/calculator [NAME...]}
+shift
+dir=$(dirname "$0")
+if [ $# -eq 0 ]; then
+	set -- $(for input in "$dir"/*.in; do basename "${input%.in}"; done)
+fi
+
+for name in "$@"; do
+	sizes=""
+	runs=""
+	[ -f "$dir/$name.n" ] && sizes=$(cat "$dir/$name.n")
+	[ -f "$dir/$name.args" ] && runs=$(cat "$dir/$name.args")
+	echo "$sizes" | while IFS= read -r n; do
+		echo "$runs" | while IFS= read -r options; do
+			start=$(date +%s%N)
+			# shellcheck disable=SC2086
+			sed "s/\\\$n/$n/g" "$dir/$name.in" | "$calculator" $options > /dev/null 2>&1
+			end=$(date +%s%N)
+			printf '%-24s %12s %-20s %8d.%03d s\n' "$name" "$n" "$options" \
+				$(((end - start) / 1000000000)) $(((end - start) / 1000000 % 1000))
+		done
+	done
+done
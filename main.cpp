@@ -16,7 +16,23 @@ Calculation:
 	Print
 	Quit
 	Help
+	Mode
 	Calculation Statement
+Mode:
+	"mode" "float"
+	"mode" "single"
+	"mode" "extended"
+	"mode" "integer"
+	"mode" "exact"
+	"mode" "rational"
+	"mode" "fixed"
+	"mode" "fixed" Number
+	"mode" "complex"
+	"mode" "modular" Number
+	"precision" Number
+	"precision" "f32"
+	"precision" "f64"
+	"precision" "mixed"
 Help:
 	"help"
 Symbols:
@@ -30,13 +46,30 @@ Quit:
 Statement:
 	Declaration
 	Assignment
-	Expression
+	Conditional
 Declaration:
-	"let" Name "=" Expression
-	"#" Name "=" Expression
-	"const" Name "=" Expression
+	"let" Name "=" Conditional
+	"#" Name "=" Conditional
+	"const" Name "=" Conditional
+	"fn" Name "=" Conditional
+	"let" Name "=" Table
+	"const" Name "=" Table
+Table:
+	"table" "(" Argument ")"
+	"table" "(" String ")"
 Assignment:
-	Name "=" Expression
+	Name "=" Conditional
+Conditional:
+	Comparison
+	Comparison "?" Conditional ":" Conditional
+Comparison:
+	Expression
+	Comparison "<" Expression
+	Comparison "<=" Expression
+	Comparison ">" Expression
+	Comparison ">=" Expression
+	Comparison "==" Expression
+	Comparison "!=" Expression
 Expression:
 	Term
 	Expression "+" Term
@@ -51,18 +84,51 @@ Secondary:
 	Secondary "!"
 Primary:
 	Number
-	"(" Expression ")"
-	"{" Expression "}"
+	"(" Conditional ")"
+	"{" Conditional "}"
 	"-" Primary
 	"+" Primary
 	Name
 	Function "(" Argument ")"
+	"powmod" "(" Conditional "," Conditional "," Conditional ")"
+	"atan2" "(" Conditional "," Conditional ")"
+	"if" "(" Conditional "," Conditional "," Conditional ")"
+	"interp" "(" Name "," Conditional ")"
+	"nCr" "(" Conditional "," Conditional ")"
+	"nPr" "(" Conditional "," Conditional ")"
+	"multinomial" "(" Argument ")"
+	"deriv" "(" Conditional "," Name ")"
+	"solve" "(" Conditional "," Name "," Conditional ")"
+	"solve" "(" Conditional "," Name "," Conditional "," Conditional ")"
+	"integrate" "(" Conditional "," Name "," Conditional "," Conditional ")"
+	"minimize" "(" Conditional "," Names "," Argument ")"
+	"odesolve" "(" Argument "," Name "," Names "," Conditional "," Argument "," Conditional ")"
+	Random "(" ")"
+	"montecarlo" "(" Conditional "," Conditional ")"
 Function:
 	"sqrt"
 	"pow"
+	"exp"
+	"log"
+	"sin"
+	"cos"
+	"tan"
+	"tanh"
+	"erf"
+	"seed"
+	"isprime"
+	"nextprime"
+	"primepi"
+	"factor"
+Random:
+	"rand"
+	"randn"
 Argument:
-	Expression
-	Argument "," Expression
+	Conditional
+	Argument "," Conditional
+Names:
+	Name
+	Names "," Name
 Name:
 	[alphabetic-char]
 	Name [alphabetic-char]
@@ -72,6 +138,20 @@ Number:
 	[floating-point-literal]
 
 Input comes from cin through the Token_stream called ts.
+The option --precision=f32|f64|mixed|Number sets the initial arithmetic,
+as the precision command does. --threads=N runs parallel work on at most
+N threads; results do not depend on it.
+
+Conditionals are parsed into an Expr tree which is then evaluated.
+A formula declared with "fn" keeps its tree, so it can be differentiated
+with "deriv" and compiled into a Program for repeated fast evaluation.
+A derivative is declared as a formula too, "fn df = deriv(f, x)", since "let"
+always stores a number. deriv collects like terms and constant factors, so
+deriv(x*x*x, x) is 3*pow(x, 2). Constants are only folded, and like terms only
+collected, in float and mixed modes, which evaluate in double; the other modes
+evaluate a formula from its tree as written.
+
+The tests directory has calculator inputs with their expected output.
 */
 
 #include <iostream>
@@ -83,6 +163,22 @@ Input comes from cin through the Token_stream called ts.
 #include <cmath>
 #include <memory>
 #include <algorithm>
+#include <limits>
+#include <thread>
+#include <exception>
+#include <cstdint>
+#include <random>
+#include <bit>
+#include <numbers>
+#include <cstdio>
+#include <cstdlib>
+#include <concepts>
+#include <type_traits>
+#include <charconv>
+#include <complex>
+#include <array>
+#include <atomic>
+#include <fstream>
 
 using namespace std;
 
@@ -100,6 +196,8 @@ public:
 		:kind{ch}, value{val} {}
 	Token(const char ch, string  n)
 		:kind{ch}, name{std::move(n)} {}
+	Token(const char ch, const double val, string n)
+		:kind{ch}, value{val}, name{std::move(n)} {}
 };
 
 // models cin as a Token stream
@@ -115,29 +213,309 @@ private:
 	istream& is;									// istream we will use
 };
 
+// models a parsed expression as a tree of operations
+class Expr {
+public:
+	char kind;										// token kind of the operation, or number or name
+	double value{};									// if kind is number then store actual numerical value here
+	string name;									// variable name, or text of a number literal
+	vector<Expr> args;								// operands, one for unary '-' and '!'
+	Expr()
+		:kind{0} {}
+	Expr(const char k, const double val)
+		:kind{k}, value{val} {}
+	Expr(const char k, string n)
+		:kind{k}, name{std::move(n)} {}
+	Expr(const char k, vector<Expr> a)
+		:kind{k}, args{std::move(a)} {}
+};
+
+class Formula;
+
+using Complex = complex<double>;
+
+// the piecewise linear function through breakpoints (x, y) of increasing x, constant beyond
+// the first and last; lookups search the x in Eytzinger (breadth first) order, so that the
+// search has no branches to mispredict and its first levels share a few cache lines
+class Table {
+public:
+	Table(vector<double> x, vector<double> y);
+	double operator()(double x) const;
+	double slope(double x) const;					// derivative at x, from the right at breakpoints
+	size_t size() const { return keys.size() - 1; }
+	double front() const { return first.x; }
+	double back() const { return last.x; }
+private:
+	struct Segment {								// from (x, y) to the next breakpoint
+		double x;
+		double y;
+		double slope;
+	};
+	Segment first;
+	Segment last;
+	vector<double> keys;							// the xs in Eytzinger order, from keys[1]
+	vector<Segment> segments;						// the segment ending at each key, so a lookup reads one more line
+	size_t place(const vector<double>& x, const vector<Segment>& s, size_t i, size_t k);
+	const Segment& segment(double x) const;			// the segment x is in, the one starting at a breakpoint x
+};
+
 // defined (name, value) pair
 class Variable {
 public:
 	string name;
 	double value;
 	bool constant;
+	shared_ptr<const Formula> formula;				// if set, value is computed from this formula
+	double imaginary = 0;							// of a complex value, only set in complex mode
+	shared_ptr<const Table> table = nullptr;		// if set, the variable is this table rather than a value
 };
 
-// defined variables and constants
+// defined variables, constants and formulas
 class Symbol_table {
 public:
 	double get_value(const string&);
+	Complex get_complex(const string&);
 	void set_value(const string&, double);
+	void set_value(const string&, Complex);
 	double define_name(const string&, double, bool);
+	Complex define_name(const string&, Complex, bool);
+	void define_formula(const string&, const Expr&, const Expr&);
+	const Formula* get_formula(const string&);
+	void define_table(const string&, shared_ptr<const Table>);
+	const Table& get_table(const string&);
+	int index_of(const string&);
+	double value_at(int);
+	const Table& table_at(int);
 	bool is_declared(const string&);
+	bool is_real_constant(const string&);
 	void print();
 private:
 	vector<Variable> var_table;
 };
 
+// a value paired with its derivative, for forward mode automatic differentiation
+class Dual {
+public:
+	double v;										// value
+	double d;										// derivative with respect to the chosen variable
+	Dual(const double val = 0, const double der = 0)
+		:v{val}, d{der} {}
+};
+
+// arbitrary precision integer, for exact mode
+class Bigint {
+public:
+	bool negative = false;
+	vector<uint32_t> mag;							// magnitude in base 2^32, least significant limb first
+	Bigint() = default;
+	explicit Bigint(int64_t v);
+	static Bigint from_unsigned(uint64_t v);
+	static Bigint from_double(double d);
+	static Bigint from_string(const string& s);
+	double to_double() const;
+	Bigint shifted(int bits) const;
+	bool is_zero() const { return mag.empty(); }
+};
+
+// binary floating point number mant * 2^exp of any precision, for precision mode; results
+// are rounded to nearest even at precision_bits and the mantissa has no trailing zero bits
+class Bigfloat {
+public:
+	Bigint mant;									// the sign is the mantissa's
+	int64_t exp = 0;
+	Bigfloat() = default;
+	Bigfloat(Bigint m, int64_t e, bool sticky = false);	// sticky if nonzero bits follow m, which then
+													// must have at least precision_bits + 2 bits
+	explicit Bigfloat(const int64_t n)
+		:Bigfloat{Bigint{n}, 0} {}
+	static Bigfloat from_double(double d);
+	static Bigfloat from_string(const string& s);
+	double to_double() const;
+	int64_t top() const;							// x < 2^top()
+	bool is_zero() const { return mant.is_zero(); }
+	bool is_integer() const { return exp >= 0; }
+};
+
+// 64 bit integer whose arithmetic reports overflow as an error, for integer mode
+class Checked {
+public:
+	int64_t v = 0;
+	Checked() = default;
+	explicit Checked(const int64_t n)
+		:v{n} {}
+	static Checked from_double(double d);
+};
+
+// residue modulo the modulus of modular mode
+class Modular {
+public:
+	uint64_t v = 0;									// below the modulus
+	Modular() = default;
+	explicit Modular(const uint64_t residue)
+		:v{residue} {}
+	static Modular from_bigint(const Bigint& n);
+	static Modular from_double(double d);
+};
+
+class Rational;
+
+// decimal fixed point number v / 10^fixed_scale, for fixed mode; results are
+// rounded half to even and overflow is an error
+class Fixed {
+public:
+	int64_t v = 0;
+	Fixed() = default;
+	explicit Fixed(const int64_t raw)
+		:v{raw} {}
+	static Fixed from_rational(const Rational& r);
+	static Fixed from_double(double d);
+	double to_double() const;
+};
+
+// exact fraction of integers, for rational mode; while numerator and denominator fit
+// in 64 bits they are kept there and only reduced when a result would overflow,
+// larger fractions are held in lowest terms as Bigints
+class Rational {
+public:
+	bool small = true;								// num/den, den > 0, otherwise big_num/big_den
+	int64_t num = 0;								// never INT64_MIN, so that it can be negated
+	int64_t den = 1;
+	Bigint big_num;
+	Bigint big_den;									// positive
+	Rational() = default;
+	explicit Rational(const int64_t n)
+		:num{n} {}
+	Rational(Bigint n, Bigint d);					// d must not be zero
+	static Rational from_double(double d);
+	static Rational from_string(const string& s);
+	double to_double() const;
+	static Rational from_lowest_terms(Bigint n, Bigint d);	// n and d must have no common factor
+	Bigint numerator() const { return small ? Bigint{num} : big_num; }
+	Bigint denominator() const { return small ? Bigint{den} : big_den; }
+	bool is_zero() const { return small ? num == 0 : big_num.is_zero(); }
+	bool is_negative() const { return small ? num < 0 : big_num.negative; }
+};
+
+// the arithmetic used for calculations
+enum class Mode {
+	single,											// single precision floating point
+	floating,										// double precision floating point
+	mixed,											// double, with bulk evaluations in single precision
+	extended,										// long double floating point
+	integer,										// 64 bit integers, overflow is an error
+	exact,											// arbitrary precision integers
+	rational,										// fractions of arbitrary precision integers
+	fixed,											// decimals with fixed_scale digits after the point
+	complex,										// complex numbers of two doubles
+	modular,										// residues modulo modular_modulus
+	precise											// floating point with precision_bits bits
+};
+
+// xoshiro256** pseudo random number generator, each thread draws from its own stream
+class Random_stream {
+public:
+	Random_stream();								// seeded from std::random_device
+	Random_stream(uint64_t seed, uint64_t stream);	// the same seed and stream give the same numbers
+	uint64_t next();
+	double uniform();								// in [0, 1)
+	double normal();								// with mean 0 and standard deviation 1
+private:
+	uint64_t s[4];
+};
+
+// table-plus-polynomial exp, log, sin, cos and tan for --fast-math=approx, whose polynomial
+// degrees are the least that keep the relative error below max_error, and pow by multiplication
+class Approx_math {
+public:
+	explicit Approx_math(double e);
+	double max_error;
+	double exp(double x) const;
+	double log(double x) const;
+	double pow(double x, double y) const;
+	double sin(double x) const;
+	double cos(double x) const;
+	double tan(double x) const;
+private:
+	static constexpr int exp_bits = 6;				// exp's table holds 2^(j/64)
+	static constexpr int log_steps = 128;			// log's table holds log(c) for c = 0.75 + j/128
+	array<double, 1 << exp_bits> exp_table;
+	array<double, 3*log_steps/4 + 1> log_table;
+	array<double, 3*log_steps/4 + 1> inverse_table;	// 1/c
+	vector<double> exp_poly;						// Taylor coefficients, lowest first
+	vector<double> log_poly;						// of log(1+t)/t
+	vector<double> sin_poly;						// of sin(r)/r, in r*r
+	vector<double> cos_poly;						// in r*r
+	bool reduce(double x, double& r, int& quadrant) const;	// x = quadrant*pi/2 + r, |r| <= pi/4
+};
+
+// an Expr compiled to flat postfix code run on a value stack, so that it
+// can be evaluated many times without walking the tree or parsing again
+class Program {
+public:
+	Program() = default;
+	Program(const Expr& e, const vector<string>& params);	// params are bound to run()'s args in order
+	double run(const double* args = nullptr) const;
+	Dual run(const Dual* args) const;				// value and derivative along the args' derivatives
+	float run(const float* args) const;				// in single precision, for mixed mode
+private:
+	struct Instr {
+		char op;
+		double value;								// constant for a number
+		int index;									// parameter slot or symbol table index for a name,
+													// the number of arguments for a function, the
+													// position of the next instruction for a jump
+	};
+	vector<Instr> code;
+	int depth = 0;									// maximum stack depth needed by code
+	void emit(const Expr& e, const vector<string>& params, int& height);
+	static bool selectable(const Expr& e, const vector<string>& params, int& size);
+	template<class T> T exec(const T* args) const;
+};
+
+// a formula: the tree of an expression as written, its simplified tree and its compiled code;
+// the simplified tree has constants folded in double, so only double evaluation may use it
+class Formula {
+public:
+	Expr source;
+	Expr expr;
+	Program code;
+	Formula(const Expr& s, const Expr& e)
+		:source{s}, expr{e}, code{e, {}} {}
+};
+
 // globals and forward declarations
-double expression(Token_stream&);
+Expr conditional_expression(Token_stream&);
+Expr simplify(const Expr&);
+double evaluate(const Expr&);
+// a function of the language: its name, arity and how calls are evaluated
+struct Builtin {
+	char kind;										// token and Expr kind of calls
+	const string& name;
+	int min_args;
+	int max_args;
+	bool pure;										// no effects, not even a note, so calls on constants are folded
+	bool compiled;									// can be used in a formula
+	double (*kernel)(const double* args, int n);	// value for doubles of the evaluated arguments, or null
+	Expr (*derivative)(const Expr& e, const string& var) = nullptr;	// unsimplified derivative of call e, or null
+													// if the function cannot be differentiated
+	double (*call)(const Expr& e) = nullptr;		// value of call e for evaluate(), if it needs the
+													// unevaluated arguments or does more than the kernel
+};
+
+const Builtin* find_builtin(const string& name);
+const Builtin* builtin(char kind);
+const string& function_key(char);
+ostream& operator<<(ostream&, const Expr&);
 Symbol_table symbols;
+string note;										// remarks on the last result, printed after it
+thread_local Random_stream random_stream;
+Mode mode = Mode::floating;
+int64_t precision_bits = 53;						// of Bigfloat results
+int fixed_scale = 2;								// decimal digits after the point in fixed mode
+uint64_t modular_modulus = 1;						// of modular mode, below 2^63
+unique_ptr<Approx_math> fast_math;					// the --fast-math=approx functions, null for the library's
+atomic<bool> approximated = false;					// whether the last result used them
+int max_threads = 0;								// that parallel_for uses, 0 for all hardware threads
 
 // token kinds
 constexpr char t_number = '8';
@@ -146,11 +524,51 @@ constexpr char t_name = 'a';
 constexpr char t_quit = 'q';
 constexpr char t_sqrt = 'S';
 constexpr char t_pow = 'P';
+constexpr char t_powmod = 'W';
+constexpr char t_isprime = 'J';
+constexpr char t_nextprime = 'K';
+constexpr char t_primepi = 'L';
+constexpr char t_factor = 'G';
+constexpr char t_ncr = 'B';
+constexpr char t_npr = 'E';
+constexpr char t_multinomial = 'U';
+constexpr char t_exp = 'H';
+constexpr char t_log = 'Q';
+constexpr char t_sin = 'T';
+constexpr char t_cos = 'V';
+constexpr char t_tan = 'Y';
+constexpr char t_atan2 = 'A';
+constexpr char t_tanh = 'y';
+constexpr char t_erf = 'f';
+constexpr char t_interp = 'j';
+constexpr char t_if = 'i';
+constexpr char t_less_equal = 'l';
+constexpr char t_greater_equal = 'g';
+constexpr char t_equal = 'e';
+constexpr char t_not_equal = 'n';
 constexpr char t_decl = '#';
 constexpr char t_assign = '=';
 constexpr char t_const = 'C';
 constexpr char t_help = 'h';
 constexpr char t_symbols = '$';
+constexpr char t_fn = 'F';
+constexpr char t_deriv = 'D';
+constexpr char t_solve = 's';
+constexpr char t_integrate = 'I';
+constexpr char t_minimize = 'M';
+constexpr char t_odesolve = 'O';
+constexpr char t_rand = 'R';
+constexpr char t_randn = 'N';
+constexpr char t_seed = 'Z';
+constexpr char t_montecarlo = 'X';
+constexpr char t_mode = 'm';
+constexpr char t_precision = 'b';
+constexpr char t_table = 'w';
+constexpr char t_string = '"';
+constexpr char t_param = 'p';						// bound parameter of a compiled Program
+constexpr char t_neg = '~';							// unary '-' of a compiled Program
+constexpr char t_branch = '^';						// jump of a compiled Program if the value is 0
+constexpr char t_jump = '@';						// unconditional jump of a compiled Program
 
 // keywords
 const string quitkey = "quit";
@@ -158,10 +576,56 @@ const string declkey = "let";
 const string constkey = "const";
 const string helpkey = "help";
 const string symbkey = "symbols";
+const string fnkey = "fn";
+const string modekey = "mode";
+const string floatkey = "float";
+const string exactkey = "exact";
+const string singlekey = "single";
+const string extendedkey = "extended";
+const string precisionkey = "precision";
+const string f32key = "f32";
+const string f64key = "f64";
+const string mixedkey = "mixed";
+const string rationalkey = "rational";
+const string integerkey = "integer";
+const string fixedkey = "fixed";
+const string complexkey = "complex";
+const string modularkey = "modular";
+const string fastmathkey = "fast-math";
+const string approxkey = "approx";
+const string threadskey = "threads";
+const string tablekey = "table";
 
 // calculator functions
 const string sqrtkey = "sqrt";
 const string powkey = "pow";
+const string powmodkey = "powmod";
+const string isprimekey = "isprime";
+const string nextprimekey = "nextprime";
+const string primepikey = "primepi";
+const string factorkey = "factor";
+const string ncrkey = "nCr";
+const string nprkey = "nPr";
+const string multinomialkey = "multinomial";
+const string expkey = "exp";
+const string logkey = "log";
+const string sinkey = "sin";
+const string coskey = "cos";
+const string tankey = "tan";
+const string atan2key = "atan2";
+const string tanhkey = "tanh";
+const string erfkey = "erf";
+const string interpkey = "interp";
+const string ifkey = "if";
+const string derivkey = "deriv";
+const string solvekey = "solve";
+const string integratekey = "integrate";
+const string minimizekey = "minimize";
+const string odesolvekey = "odesolve";
+const string randkey = "rand";
+const string randnkey = "randn";
+const string seedkey = "seed";
+const string montecarlokey = "montecarlo";
 
 
 // put Token t back into Token_stream buffer
@@ -188,7 +652,6 @@ Token Token_stream::get() {
 			return Token{t_print};
 		case t_decl:
 		case t_quit:
-		case t_assign:
 		case '(': case ')':
 		case '{': case '}':
 		case ',':								// separation of args in pow function
@@ -196,16 +659,63 @@ Token Token_stream::get() {
 		case '-':
 		case '*':
 		case '/':
-		case '!':
+		case '%':
+		case '?':
+		case ':':
 			return Token{ch};					// let each character represent itself
+		case '<':								// and these unless '=' follows
+		case '>':
+		case t_assign:
+		case '!':
+			if (cin.peek() != '=')
+				return Token{ch};
+			cin.get();
+			switch (ch) {
+				case '<':
+					return Token{t_less_equal};
+				case '>':
+					return Token{t_greater_equal};
+				case t_assign:
+					return Token{t_equal};
+				default:
+					return Token{t_not_equal};
+			}
+		case t_string:							// a file name, up to the closing quote on the same line
+		{
+			string s;
+			while (cin.get(ch) && ch != t_string && ch != '\n')
+				s += ch;
+			if (ch != t_string) {
+				if (ch == '\n')
+					cin.putback(ch);
+				throw runtime_error("'\"' expected after " + s);
+			}
+			return Token{t_string, 0, s};
+		}
 		case '.':								// floating-point literal can start with dot
 		case '0': case '1': case '2': case '3': case '4':
 		case '5': case '6': case '7': case '8': case '9':
 		{
-			cin.putback(ch);
-			double val = 0;
-			cin >> val;							// reads entire double, not just first digit
-			return Token{t_number, val};
+			string s;							// keep the literal's text, exact mode reads it as an integer
+			s += ch;
+			while (cin.get(ch) && (isdigit(ch) || ch == '.'))
+				s += ch;
+			if (cin && (ch == 'e' || ch == 'E')
+				&& (isdigit(cin.peek()) || cin.peek() == '+' || cin.peek() == '-')) {
+				s += ch;						// exponent
+				cin.get(ch);
+				s += ch;
+				while (cin.get(ch) && isdigit(ch))
+					s += ch;
+			}
+			if (cin)
+				cin.putback(ch);
+
+			char* end = nullptr;
+			const double val = strtod(s.c_str(), &end);	// infinity if too large, exact mode uses s
+			if (end != s.c_str() + s.size())
+				throw runtime_error("bad number " + s);
+			return Token{t_number, val, s};
 		}
 		default:
 			if (isalpha(ch)) {					// can also expect strings
@@ -219,10 +729,16 @@ Token Token_stream::get() {
 					return Token{t_const};
 				if (s == declkey)
 					return Token{t_decl};
-				if (s == sqrtkey)
-					return Token{t_sqrt};
-				if (s == powkey)
-					return Token{t_pow};
+				if (const Builtin* b = find_builtin(s))
+					return Token{b->kind};
+				if (s == fnkey)
+					return Token{t_fn};
+				if (s == tablekey)
+					return Token{t_table};
+				if (s == modekey)
+					return Token{t_mode};
+				if (s == precisionkey)
+					return Token{t_precision};
 				if (s == helpkey)
 					return Token{t_help};
 				if (s == symbkey)
@@ -250,21 +766,118 @@ void Token_stream::ignore(const char c) {
 			return;
 }
 
-// return the value of the Variable named s
+// z as a + bi, leaving out zero parts and unit factors
+string format(const Complex& z) {
+	ostringstream os;
+	const double a = z.real() == 0 ? 0 : z.real();	// no negative zeros
+	const double b = z.imag();
+	if (b == 0 || a != 0)
+		os << a;
+	if (b != 0) {
+		if (b < 0)
+			os << '-';
+		else if (a != 0)
+			os << '+';
+		if (abs(b) != 1)
+			os << abs(b);
+		os << 'i';
+	}
+	return os.str();
+}
+
+Table::Table(vector<double> x, vector<double> y) {
+	if (x.empty() || x.size() != y.size())
+		throw runtime_error(tablekey + ": pairs of x and y expected");
+	vector<Segment> s;								// s[i] ends at x[i], s[0] is only a placeholder
+	for (size_t i = 0; i < x.size(); ++i) {
+		if (!isfinite(x[i]) || !isfinite(y[i]))
+			throw runtime_error(tablekey + ": breakpoints must be finite");
+		if (i == 0)
+			s.push_back(Segment{x[0], y[0], 0});
+		else if (x[i] <= x[i-1])
+			throw runtime_error(tablekey + ": x must increase from each breakpoint to the next");
+		else
+			s.push_back(Segment{x[i-1], y[i-1], (y[i] - y[i-1]) / (x[i] - x[i-1])});
+	}
+	first = Segment{x.front(), y.front(), 0};
+	last = Segment{x.back(), y.back(), 0};
+	keys.resize(x.size() + 1);
+	segments.resize(x.size() + 1);
+	place(x, s, 0, 1);
+}
+
+// in order, so that the left subtree of k (at 2k) holds the smaller xs and the right (at 2k+1)
+// the larger; return the next i
+size_t Table::place(const vector<double>& x, const vector<Segment>& s, size_t i, const size_t k) {
+	if (k >= keys.size())
+		return i;
+	i = place(x, s, i, 2*k);
+	keys[k] = x[i];
+	segments[k] = s[i];
+	return place(x, s, i + 1, 2*k + 1);
+}
+
+// descend to a leaf, going right past keys <= x, then undo the right turns below the last
+// left turn, whose node holds the first key > x; x must be from front() up to back()
+const Table::Segment& Table::segment(const double x) const {
+	size_t k = 1;
+	while (k < keys.size())
+		k = 2*k + (keys[k] <= x);
+	k >>= countr_one(k) + 1;
+	return segments[k];
+}
+
+double Table::operator()(const double x) const {
+	if (x <= first.x)
+		return first.y;
+	if (x >= last.x)
+		return last.y;
+	const Segment& s = segment(x);
+	return s.y + (x - s.x) * s.slope;
+}
+
+double Table::slope(const double x) const {
+	if (x < first.x || x >= last.x)
+		return 0;
+	return segment(x).slope;
+}
+
+ostream& operator<<(ostream& os, const Table& t) {
+	return os << tablekey << " of " << t.size() << (t.size() == 1 ? " breakpoint" : " breakpoints")
+		<< ", x from " << t.front() << " to " << t.back();
+}
+
+// return the value of the Variable named s, which must be real
 double Symbol_table::get_value(const string& s) {
-	for (const auto&[name, value, constant] : var_table)
-		if (name == s)
-			return value;
+	const Complex z = get_complex(s);
+	if (z.imag() != 0)
+		throw runtime_error(s + " is complex, use " + modekey + " " + complexkey);
+	return z.real();
+}
+
+// return the value of the Variable named s
+Complex Symbol_table::get_complex(const string& s) {
+	for (const auto&[name, value, constant, formula, imaginary, table] : var_table)
+		if (name == s) {
+			if (table)
+				throw runtime_error(s + " is a " + tablekey + ", use " + interpkey + "(" + s + ", x)");
+			return formula ? formula->code.run() : Complex{value, imaginary};
+		}
 	throw runtime_error("trying to read undefined variable " + s);
 }
 
 // set the value of Variable named s to d
 void Symbol_table::set_value(const string& s, const double d) {
-	for (auto&[name, value, constant] : var_table)
+	set_value(s, Complex{d});
+}
+
+void Symbol_table::set_value(const string& s, const Complex z) {
+	for (auto&[name, value, constant, formula, imaginary, table] : var_table)
 		if (name == s) {
 			if (constant == true)
 				throw runtime_error("trying to write to constant");
-			value = d;
+			value = z.real();
+			imaginary = z.imag();
 			return;
 		}
 	throw runtime_error("trying to write undefined variable " + s);
@@ -277,253 +890,5317 @@ bool Symbol_table::is_declared(const string& var) {
 		[var](const Variable& v) { return v.name == var; });
 }
 
+// is var a constant real number, which can be read without error and never changes?
+bool Symbol_table::is_real_constant(const string& var) {
+	return ranges::any_of(
+		var_table,
+		[var](const Variable& v) { return v.name == var && v.constant && !v.formula && !v.table && v.imaginary == 0; });
+}
+
 // add {var, val} to var_table
 double Symbol_table::define_name(const string& var, const double val, const bool constant) {
+	define_name(var, Complex{val}, constant);
+	return val;
+}
+
+Complex Symbol_table::define_name(const string& var, const Complex val, const bool constant) {
 	if (is_declared(var))
 		throw runtime_error(var + " declared twice");
-	var_table.push_back(Variable{var, val, constant});
+	var_table.push_back(Variable{var, val.real(), constant, nullptr, val.imag()});
 	return val;
 }
 
+// add formula var written as source and simplified to e to var_table, formulas cannot be assigned to
+void Symbol_table::define_formula(const string& var, const Expr& source, const Expr& e) {
+	if (is_declared(var))
+		throw runtime_error(var + " declared twice");
+	auto f = make_shared<const Formula>(source, e);	// compiling checks that all names are declared
+	var_table.push_back(Variable{var, 0, true, std::move(f)});
+}
+
+// return the formula named s, or nullptr if s is a plain variable
+const Formula* Symbol_table::get_formula(const string& s) {
+	for (const auto&[name, value, constant, formula, imaginary, table] : var_table)
+		if (name == s)
+			return formula.get();
+	return nullptr;
+}
+
+// add table var to var_table, tables cannot be assigned to
+void Symbol_table::define_table(const string& var, shared_ptr<const Table> t) {
+	if (is_declared(var))
+		throw runtime_error(var + " declared twice");
+	var_table.push_back(Variable{var, 0, true, nullptr, 0, std::move(t)});
+}
+
+// return the table named s
+const Table& Symbol_table::get_table(const string& s) {
+	return table_at(index_of(s));
+}
+
+// return the position of the Variable named s, stable as variables are never removed
+int Symbol_table::index_of(const string& s) {
+	for (int i = 0; i < static_cast<int>(var_table.size()); ++i)
+		if (var_table[i].name == s)
+			return i;
+	throw runtime_error("trying to read undefined variable " + s);
+}
+
+// return the value of the Variable at position i, which must be real
+double Symbol_table::value_at(const int i) {
+	const Variable& v = var_table[i];
+	if (v.imaginary != 0)
+		throw runtime_error(v.name + " is complex, use " + modekey + " " + complexkey);
+	if (v.table)
+		throw runtime_error(v.name + " is a " + tablekey + ", use " + interpkey + "(" + v.name + ", x)");
+	return v.formula ? v.formula->code.run() : v.value;
+}
+
+// return the table at position i
+const Table& Symbol_table::table_at(const int i) {
+	const Variable& v = var_table[i];
+	if (!v.table)
+		throw runtime_error(v.name + " is not a " + tablekey);
+	return *v.table;
+}
+
 void Symbol_table::print() {
 	cout << "\nSymbols:\n";
-	for (const auto&[name, value, constant] : var_table)
-		cout << name << '\t' << value << '\n';
+	for (const auto&[name, value, constant, formula, imaginary, table] : var_table)
+		if (formula)
+			cout << name << '\t' << formula->expr << '\n';
+		else if (table)
+			cout << name << '\t' << *table << '\n';
+		else
+			cout << name << '\t' << format(Complex{value, imaginary}) << '\n';
 	cout << '\n';
 }
 
-// return result of factorial of arg x
-double factorial(int x) {
-	if (x < 0)
+// n! in the integer type I, with an error if it does not fit
+template<integral I> I checked_factorial(const I n) {
+	if (n < 0)
 		throw runtime_error("cannot get factorial of negative number.");
 
-	if (x == 0)
-		x = 1;
-
-	for (int i = x-1; i > 0; --i) {
-		const int prev = x;
-		x *= i;
-
-		if (prev != 0 && x/prev != i)
+	I x = 1;
+	for (I i = 2; i <= n; ++i)
+		if (__builtin_mul_overflow(x, i, &x))
 			throw runtime_error("overflow occurred in int.");
-	}
 
 	return x;
 }
 
-double eval_function(Token_stream& ts, Token t) {
-	switch (t.kind) {
-		case t_sqrt:
-		{
-			t = ts.get();
-			double inner;
-			switch (t.kind) {
-				case '(':
-				{
-					const double d = expression(ts);
-					t = ts.get();
-					if (t.kind != ')')
-						throw runtime_error("sqrt: ')' expected");
-					if (d < 0)
-						throw runtime_error("cannot get square root of negative number");
-					inner = d;
-					break;
-				}
-				default:
-					throw runtime_error("sqrt: primary expected");
-			}
-			return sqrt(inner);
+// n! for n = 0..170 correctly rounded to double, beyond that it overflows; the product is
+// kept exactly in 32 bit limbs at compile time and rounded half to even
+constexpr array<double, 171> factorial_table = [] {
+	array<double, 171> table{};
+	array<uint32_t, 32> n{1};						// n! < 2^1024
+	size_t size = 1;
+	for (size_t i = 0; i < table.size(); ++i) {
+		uint64_t carry = 0;
+		for (size_t k = 0; i > 1 && k < size; ++k) {
+			carry += uint64_t{n[k]} * i;
+			n[k] = static_cast<uint32_t>(carry);
+			carry >>= 32;
 		}
-		case t_pow:
-		{
-			t = ts.get();
-			double exp1, exp2;
-			switch(t.kind) {
-				case '(':
-				{
-					double d = expression(ts);
-					t = ts.get();
-					if (t.kind != ',')
-						throw runtime_error("pow: ',' expected");
-					exp1 = d;
-
-					d = expression(ts);
-					t = ts.get();
-					if (t.kind != ')')
-						throw runtime_error("pow: ')' expected");
-					exp2 = d;
+		if (carry != 0)
+			n[size++] = static_cast<uint32_t>(carry);
 
-					break;
-				}
-				default:
-					throw runtime_error("pow: primary expected");
-			}
-			return pow(exp1, exp2);
+		const auto bit = [&n](const size_t b) { return n[b/32] >> b%32 & 1; };
+		size_t length = 32*size;
+		while (bit(length - 1) == 0)
+			--length;
+		const size_t shift = length > 53 ? length - 53 : 0;
+		uint64_t mant = 0;
+		for (size_t b = length; b > shift; --b)
+			mant = mant << 1 | bit(b - 1);
+		if (shift > 0 && bit(shift - 1) == 1) {		// at least half, ties go to the even mantissa
+			bool sticky = false;
+			for (size_t b = 0; b + 1 < shift; ++b)
+				sticky = sticky || bit(b) == 1;
+			if (sticky || (mant & 1) == 1)
+				++mant;
 		}
-		default:
-			throw runtime_error("function not implemented");
+		double x = static_cast<double>(mant);		// exact, and so is scaling by 2
+		for (size_t b = 0; b < shift; ++b)
+			x *= 2;
+		table[i] = x;
 	}
-}
+	return table;
+}();
 
-// deal with numbers, signage, names, functions, assignment, and parentheses/braces
-double primary(Token_stream& ts) {
-	switch (Token t = ts.get(); t.kind) {
-		case '(':
-		{
-			const double d = expression(ts);
-			t = ts.get();
-			if (t.kind != ')')
-				throw runtime_error("')' expected");
-			return d;
-		}
-		case '{':
-		{
-			const double d = expression(ts);
-			t = ts.get();
-			if (t.kind != '}')
-				throw runtime_error("'}' expected");
-			return d;
-		}
-		case t_sqrt:
-		case t_pow:
-			return eval_function(ts, t);
-		case t_number:
-			return t.value;
-		case '-':
-			return - primary(ts);
-		case '+':
-			return + primary(ts);
-		case t_name: {
-			return symbols.get_value(t.name);
-		}
-		default:
-			throw runtime_error("primary expected");
-	}
+// x! = gamma(x + 1): from the table for integers, so 0..22! are exact, and otherwise
+// by the library's gamma function; an error for negative x and if x! overflows
+template<floating_point F> F factorial(const F x) {
+	if (x < 0)
+		throw runtime_error("cannot get factorial of negative number.");
+	if (x == trunc(x) && x < factorial_table.size() && (is_same_v<F, double> || x <= 22))
+		return static_cast<F>(factorial_table[static_cast<size_t>(x)]);
+	const F r = tgamma(x + 1);
+	if (!isfinite(r))
+		throw runtime_error("!: result too large");
+	return r;
 }
 
-// deal with factorials, '!'
-double secondary(Token_stream& ts) {
-	double left = primary(ts);
-	Token t = ts.get();
-	while (true) {
-		switch (t.kind) {
-			case '!':
-				left = factorial(static_cast<int>(left));
-				t = ts.get();
-				break;
-			default:
-				ts.putback(t);
-				return left;
-		}
-	}
+// digamma(x) = gamma'(x) / gamma(x) for x > 0, by recurrence up to 10 and then the asymptotic series
+double digamma(double x) {
+	double r = 0;
+	for (; x < 10; ++x)
+		r -= 1 / x;
+	const double x2 = 1 / (x*x);
+	return r + log(x) - 1 / (2*x)
+		- x2 * (1.0/12 - x2 * (1.0/120 - x2 * (1.0/252 - x2 * (1.0/240 - x2 / 132))));
 }
 
-// deal with '*', '/', and '%'
-double term(Token_stream& ts) {
-	double left = secondary(ts);
-	Token t = ts.get();
-	while (true) {
-		switch (t.kind) {
-			case '*':
-				left *= secondary(ts);
-				t = ts.get();
-				break;
-			case '/':
-			{
-				const double d = secondary(ts);
-				if (d == 0)
-					throw runtime_error("divide by zero");
-				left /= d;
-				t = ts.get();
-				break;
-			}
-			case '%':
-			{
-				const double d = secondary(ts);
-				if (d == 0)
-					throw runtime_error("%: divide by zero");
-				left = fmod(left, d);
-				t = ts.get();
-				break;
-			}
-			default:
-				ts.putback(t);
-				return left;
-		}
-	}
+Dual operator-(const Dual& a) { return {-a.v, -a.d}; }
+Dual operator+(const Dual& a, const Dual& b) { return {a.v + b.v, a.d + b.d}; }
+Dual operator-(const Dual& a, const Dual& b) { return {a.v - b.v, a.d - b.d}; }
+Dual operator*(const Dual& a, const Dual& b) { return {a.v * b.v, a.d*b.v + a.v*b.d}; }
+Dual operator/(const Dual& a, const Dual& b) { return {a.v / b.v, (a.d*b.v - a.v*b.d) / (b.v*b.v)}; }
+
+Dual sqrt(const Dual& a) {
+	const double s = sqrt(a.v);
+	return {s, a.d / (2*s)};
 }
 
-// deal with '+' and '-'
-double expression(Token_stream& ts) {
-	double left = term(ts);
-	Token t = ts.get();
-	while (true) {
-		switch (t.kind) {
-			case '+':
-				left += term(ts);
-				t = ts.get();
-				break;
-			case '-':
-				left -= term(ts);
-				t = ts.get();
-				break;
-			default:
-				ts.putback(t);
-				return left;
-		}
-	}
+Dual pow(const Dual& a, const Dual& b) {
+	const double p = pow(a.v, b.v);
+	double d = b.v * pow(a.v, b.v-1) * a.d;
+	if (b.d != 0)
+		d += p * log(a.v) * b.d;
+	return {p, d};
 }
 
-// declare a variable called 'name' with the initial value 'expression'
-double declaration(Token_stream& ts, const bool constant) {
-	const Token t = ts.get();
-	if (t.kind != t_name)
-		throw runtime_error("name expected in declaration");
+Dual fmod(const Dual& a, const Dual& b) {
+	return {fmod(a.v, b.v), a.d - trunc(a.v / b.v) * b.d};
+}
 
-	if (const Token t2 = ts.get(); t2.kind != '=')
-		throw runtime_error("'=' missing in declaration of " + t.name);
-	const double d = expression(ts);
-	symbols.define_name(t.name, d, constant);
-	return d;
+// (x!)' = gamma(x + 1) digamma(x + 1)
+Dual factorial(const Dual& a) {
+	const double f = factorial(a.v);
+	return {f, a.d == 0 ? 0 : f * digamma(a.v + 1) * a.d};
 }
 
-// give new value to named variable
-double assignment(Token_stream& ts) {
-	const Token t = ts.get();
-	const string var_name = t.name;
+constexpr double default_approx_error = 1e-7;		// relative error of --fast-math=approx
+constexpr double min_approx_error = 1e-12;			// a few hundred ulps, above the rounding of the tables
+constexpr double max_approx_error = 1e-2;
+constexpr double reduction_limit = 1e5;				// sin and cos of larger x are the library's
+constexpr double max_multiplied_exponent = 1024;	// pow of integer exponents up to this multiplies
 
-	if (!symbols.is_declared(var_name))
-		throw runtime_error(var_name + " has not been declared");
+// the relative error of the approximations beyond the truncation of their polynomials: the
+// tables' rounding, and that of the few operations evaluating them
+constexpr double approx_rounding = 16 * numeric_limits<double>::epsilon();
 
-	ts.get();								// skip the '='
-	const double d = expression(ts);
-	symbols.set_value(var_name, d);
-	return d;
+// Taylor coefficients c[0..] of a series whose terms are term(i), up to the first degree whose
+// truncation error bound(degree) is below e
+template<class T, class B> vector<double> taylor(const double e, T term, B bound) {
+	vector<double> c;
+	for (int d = 0; c.empty() || bound(d - 1) + approx_rounding > e; ++d)
+		c.push_back(term(d));
+	return c;
 }
 
-// deal with 'let'
-double statement(Token_stream& ts) {
-	switch (const Token t = ts.get(); t.kind) {
-		case t_const:
-			return declaration(ts, true);
-		case t_decl:
-			return declaration(ts, false);
-		case t_name: {
-			const Token t2 = ts.get();
-			ts.putback(t2);				// need to rollback tokens to be usable
-			ts.putback(t);
+// note that the result depends on an approximation, without writing to the flag's cache line
+// from every thread of a montecarlo once it is set
+void mark_approximated() {
+	if (!approximated.load(memory_order_relaxed))
+		approximated.store(true, memory_order_relaxed);
+}
 
-			if (t2.kind == t_assign)
-				return assignment(ts);
-			break;
-		}
-		default:
-			ts.putback(t);
-	}
-	return expression(ts);
+double horner(const vector<double>& c, const double x) {
+	double p = c.back();
+	for (size_t i = c.size() - 1; i-- > 0; )
+		p = p*x + c[i];
+	return p;
 }
 
-// move to start of next expression
+Approx_math::Approx_math(const double e)
+	:max_error{e}
+{
+	for (size_t j = 0; j < exp_table.size(); ++j)
+		exp_table[j] = exp2(static_cast<double>(j) / exp_table.size());
+	for (size_t j = 0; j < log_table.size(); ++j) {
+		const double c = 0.75 + static_cast<double>(j) / log_steps;
+		log_table[j] = std::log(c);
+		inverse_table[j] = 1 / c;
+	}
+
+	// |r| <= ln(2)/128 for exp, |t| <= 1/192 for log, |r| <= pi/4 for sin and cos
+	const double r_exp = numbers::ln2 / (2 << exp_bits) * (1 + 1e-9);
+	const double t_log = 1.0 / (2*log_steps * 0.75);
+	const double r_trig = numbers::pi / 4 * (1 + 1e-9);
+	auto factorial = [](const int n) { return tgamma(n + 1.0); };
+
+	exp_poly = taylor(e, [&](const int i) { return 1 / factorial(i); },
+		[&](const int d) { return std::pow(r_exp, d + 1) / factorial(d + 1) * std::exp(r_exp); });
+
+	// log(1+t)/t = 1 - t/2 + t^2/3 - ..., relative to the least |log(x)| of 1/256 when t is not all of it
+	log_poly = taylor(e, [](const int i) { return (i % 2 == 0 ? 1.0 : -1.0) / (i + 1); },
+		[&](const int d) { return 1.4 * std::pow(t_log, d + 1) / (d + 2); });
+
+	// in r*r, relative to sin(r)/r >= 0.9 and cos(r) >= 0.7, each within half so that tan is too
+	sin_poly = taylor(e / 2, [&](const int i) { return (i % 2 == 0 ? 1 : -1) / factorial(2*i + 1); },
+		[&](const int d) { return std::pow(r_trig, 2*d + 2) / factorial(2*d + 3) / 0.9; });
+	cos_poly = taylor(e / 2, [&](const int i) { return (i % 2 == 0 ? 1 : -1) / factorial(2*i); },
+		[&](const int d) { return std::pow(r_trig, 2*d + 2) / factorial(2*d + 2) / 0.7; });
+}
+
+// exp(x) = 2^(k/64) exp(r) with r = x - k ln(2)/64
+double Approx_math::exp(const double x) const {
+	mark_approximated();
+	if (!(abs(x) < 700))							// overflow, underflow and NaN
+		return std::exp(x);
+	constexpr double shifter = 0x1.8p52;			// adding it rounds to an integer
+	constexpr double ln2_hi = 6.93147180369123816490e-01 / 64;	// 32 bits, so k*ln2_hi is exact
+	constexpr double ln2_lo = 1.90821492927058770002e-10 / 64;
+	const double k = (x * (64 / numbers::ln2) + shifter) - shifter;
+	const double r = (x - k*ln2_hi) - k*ln2_lo;
+	const auto n = static_cast<int64_t>(k);
+	const double scale = bit_cast<double>(static_cast<uint64_t>(1023 + (n >> exp_bits)) << 52);
+	return scale * exp_table[n & ((1 << exp_bits) - 1)] * horner(exp_poly, r);
+}
+
+// log(x) = e ln(2) + log(c) + log(1 + t) for x = m 2^e with m in [0.75, 1.5) and
+// t = (m - c) / c, where c is the nearest table point to m and m - c is exact
+double Approx_math::log(const double x) const {
+	mark_approximated();
+	if (!(x >= numeric_limits<double>::min() && x <= numeric_limits<double>::max()))
+		return std::log(x);							// zero, negative, subnormal, infinite and NaN
+	constexpr double ln2_hi = 6.93147180369123816490e-01;
+	constexpr double ln2_lo = 1.90821492927058770002e-10;
+	const auto bits = bit_cast<uint64_t>(x);
+	const uint64_t halved = bits >> 51 & 1;			// the mantissa is at least 1.5, so m is half of it
+	const auto e = static_cast<double>(static_cast<int64_t>((bits >> 52) + halved) - 1023);
+	const double m = bit_cast<double>((bits & ((uint64_t{1} << 52) - 1)) | ((1023 - halved) << 52));
+	constexpr double shifter = 0x1.8p52 / log_steps;	// adding it rounds to a multiple of 1/log_steps
+	const double rounded = m + shifter;
+	const double c = rounded - shifter;
+	const auto j = (bit_cast<uint64_t>(rounded) & (2*log_steps - 1)) - 3*log_steps/4;
+	const double t = (m - c) * inverse_table[j];
+	return e*ln2_hi + (log_table[j] + (e*ln2_lo + t*horner(log_poly, t)));
+}
+
+// x^y by squaring for integer y up to max_multiplied_exponent, whose relative error of about
+// |y| ulps is below min_approx_error, sqrt(x) for y = 0.5, and otherwise the library's pow, which
+// is faster than exp(y log(x)) with the accuracy that |y log(x)| would need of log
+double Approx_math::pow(const double x, const double y) const {
+	mark_approximated();
+	if (y == 0.5 && x > 0)
+		return sqrt(x);
+	if (y != trunc(y) || !(abs(y) <= max_multiplied_exponent))
+		return std::pow(x, y);
+	double r = 1;
+	double p = x;
+	for (auto n = static_cast<uint64_t>(abs(y)); n != 0; n >>= 1) {
+		if (n & 1)
+			r *= p;
+		p *= p;
+	}
+	if (!isnormal(r))								// x^|y| overflowed or lost bits, x^y may not have
+		return std::pow(x, y);
+	return y < 0 ? 1 / r : r;
+}
+
+// x - k pi/2 in three parts, of which the first two have 33 bits so that k times them is exact;
+// false where x is too large or r too close to 0 for r to keep its relative accuracy
+bool Approx_math::reduce(const double x, double& r, int& quadrant) const {
+	if (!(abs(x) < reduction_limit))
+		return false;
+	constexpr double shifter = 0x1.8p52;
+	constexpr double pio2_1 = 1.57079632673412561417e+00;
+	constexpr double pio2_2 = 6.07710050630396597660e-11;
+	constexpr double pio2_3 = 2.02226624879595063154e-21;
+	const double k = (x * (2 / numbers::pi) + shifter) - shifter;
+	r = ((x - k*pio2_1) - k*pio2_2) - k*pio2_3;
+	quadrant = static_cast<int>(static_cast<int64_t>(k) & 3);
+	return k == 0 || abs(r) > 0x1p-30;
+}
+
+double Approx_math::sin(const double x) const {
+	mark_approximated();
+	double r;
+	int q;
+	if (!reduce(x, r, q))
+		return std::sin(x);
+	const double s = r * horner(sin_poly, r*r);		// both, so that the quadrant does not branch
+	const double c = horner(cos_poly, r*r);
+	const double v = q % 2 == 0 ? s : c;
+	return q < 2 ? v : -v;
+}
+
+double Approx_math::cos(const double x) const {
+	mark_approximated();
+	double r;
+	int q;
+	if (!reduce(x, r, q))
+		return std::cos(x);
+	const double s = r * horner(sin_poly, r*r);
+	const double c = horner(cos_poly, r*r);
+	const double v = q % 2 == 0 ? c : s;
+	return q == 0 || q == 3 ? v : -v;
+}
+
+// sin(r)/cos(r), or -cos(r)/sin(r) in odd quadrants; the errors of sin and cos add up
+double Approx_math::tan(const double x) const {
+	mark_approximated();
+	double r;
+	int q;
+	if (!reduce(x, r, q))
+		return std::tan(x);
+	const double s = r * horner(sin_poly, r*r);
+	const double c = horner(cos_poly, r*r);
+	return q % 2 == 0 ? s / c : -c / s;
+}
+
+// the elementary function k of a[0], or of a[0] and a[1] for pow and atan2, by the library's
+// functions, whose results are within 1 ulp for double, or for doubles by the approximations of
+// --fast-math=approx where they exist; an error for log of a negative number
+template<floating_point F> F elementary(const char k, const F* a) {
+	const bool approximate = is_same_v<F, double> && fast_math;
+	switch (k) {
+		case t_pow:
+			return approximate ? fast_math->pow(a[0], a[1]) : pow(a[0], a[1]);
+		case t_exp:
+			return approximate ? fast_math->exp(a[0]) : exp(a[0]);
+		case t_log:
+			if (a[0] < 0)
+				throw runtime_error("cannot get logarithm of negative number");
+			return approximate ? fast_math->log(a[0]) : log(a[0]);
+		case t_sin:
+			return approximate ? fast_math->sin(a[0]) : sin(a[0]);
+		case t_cos:
+			return approximate ? fast_math->cos(a[0]) : cos(a[0]);
+		case t_tan:
+			return approximate ? fast_math->tan(a[0]) : tan(a[0]);
+		case t_atan2:
+			return atan2(a[0], a[1]);
+		case t_tanh:
+			return tanh(a[0]);
+		case t_erf:
+			return erf(a[0]);
+		default:
+			throw runtime_error("function not implemented");
+	}
+}
+
+Dual elementary(const char k, const Dual* a) {
+	const double v = a[0].v;
+	const double d = a[0].d;
+	switch (k) {
+		case t_pow:
+			return pow(a[0], a[1]);
+		case t_exp:
+		{
+			const double e = exp(v);
+			return {e, e * d};
+		}
+		case t_log:
+			return {elementary(k, &v), d / v};
+		case t_sin:
+			return {sin(v), cos(v) * d};
+		case t_cos:
+			return {cos(v), -sin(v) * d};
+		case t_tan:
+		{
+			const double t = tan(v);
+			return {t, (1 + t*t) * d};
+		}
+		case t_atan2:								// (x y' - y x') / (x*x + y*y) for atan2(y, x)
+		{
+			const double x = a[1].v;
+			return {atan2(v, x), (x*d - v*a[1].d) / (x*x + v*v)};
+		}
+		case t_tanh:
+		{
+			const double t = tanh(v);
+			return {t, (1 - t*t) * d};
+		}
+		case t_erf:
+			return {erf(v), 2 / sqrt(numbers::pi) * exp(-v*v) * d};
+		default:
+			throw runtime_error("function not implemented");
+	}
+}
+
+// the table t at x; a Dual carries the slope of the segment x is in
+template<floating_point F> F interpolate(const Table& t, const F x) { return static_cast<F>(t(x)); }
+Dual interpolate(const Table& t, const Dual x) { return {t(x.v), t.slope(x.v) * x.d}; }
+
+// the builtins report whether the exact result fits, without dividing back
+Checked operator-(const Checked a) {
+	Checked r;
+	if (__builtin_sub_overflow(int64_t{0}, a.v, &r.v))
+		throw runtime_error(integerkey + ": overflow");
+	return r;
+}
+
+Checked operator+(const Checked a, const Checked b) {
+	Checked r;
+	if (__builtin_add_overflow(a.v, b.v, &r.v))
+		throw runtime_error(integerkey + ": overflow");
+	return r;
+}
+
+Checked operator-(const Checked a, const Checked b) {
+	Checked r;
+	if (__builtin_sub_overflow(a.v, b.v, &r.v))
+		throw runtime_error(integerkey + ": overflow");
+	return r;
+}
+
+Checked operator*(const Checked a, const Checked b) {
+	Checked r;
+	if (__builtin_mul_overflow(a.v, b.v, &r.v))
+		throw runtime_error(integerkey + ": overflow");
+	return r;
+}
+
+// truncated like C++ division, b must not be zero
+Checked operator/(const Checked a, const Checked b) {
+	if (a.v == numeric_limits<int64_t>::min() && b.v == -1)
+		throw runtime_error(integerkey + ": overflow");
+	return Checked{a.v / b.v};
+}
+
+// remainder with the sign of a, b must not be zero
+Checked operator%(const Checked a, const Checked b) {
+	return Checked{b.v == -1 ? 0 : a.v % b.v};
+}
+
+// the integer d, which must be whole and in range
+Checked Checked::from_double(const double d) {
+	if (!isfinite(d) || d != trunc(d))
+		throw runtime_error(integerkey + ": integer expected");
+	if (d < -0x1p63 || d >= 0x1p63)
+		throw runtime_error(integerkey + ": value out of range");
+	return Checked{static_cast<int64_t>(d)};
+}
+
+ostream& operator<<(ostream& os, const Checked x) {
+	return os << x.v;
+}
+
+// expand the 64 bit seed into a generator state, as recommended for xoshiro
+uint64_t splitmix64(uint64_t& x) {
+	uint64_t z = (x += 0x9e3779b97f4a7c15);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+Random_stream::Random_stream()
+	:Random_stream{(static_cast<uint64_t>(random_device{}()) << 32) | random_device{}(), 0} {}
+
+Random_stream::Random_stream(const uint64_t seed, uint64_t stream) {
+	uint64_t x = seed ^ splitmix64(stream);
+	for (uint64_t& w : s)
+		w = splitmix64(x);
+}
+
+uint64_t Random_stream::next() {
+	const uint64_t result = rotl(s[1] * 5, 7) * 9;
+	const uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+double Random_stream::uniform() {
+	return static_cast<double>(next() >> 11) * 0x1.0p-53;
+}
+
+// Box-Muller transform of two uniform numbers
+double Random_stream::normal() {
+	const double u = 1 - uniform();					// in (0, 1], so log(u) is finite
+	const double v = uniform();
+	return sqrt(-2*log(u)) * cos(2*numbers::pi*v);
+}
+
+double value_of(const double x) { return x; }
+double value_of(const Dual& x) { return x.v; }
+
+// whether a k b holds for the comparison k
+template<class T> bool compare(const char k, const T& a, const T& b) {
+	switch (k) {
+		case '<':
+			return a < b;
+		case t_less_equal:
+			return a <= b;
+		case '>':
+			return a > b;
+		case t_greater_equal:
+			return a >= b;
+		case t_equal:
+			return a == b;
+		case t_not_equal:
+			return a != b;
+		default:
+			throw runtime_error("comparison not implemented");
+	}
+}
+
+// the text of the comparison k
+string comparison_key(const char k) {
+	switch (k) {
+		case t_less_equal:
+			return "<=";
+		case t_greater_equal:
+			return ">=";
+		case t_equal:
+			return "==";
+		case t_not_equal:
+			return "!=";
+		default:
+			return string{k};
+	}
+}
+
+// run f(i) for every i in [0, n), spread over the hardware threads in chunks of at least grain
+template<class F> void parallel_for(const int n, F f, const int grain = 1) {
+	static const int cores = static_cast<int>(thread::hardware_concurrency());	// not free to query
+	const int threads = min(max_threads > 0 ? max_threads : cores, n / max(grain, 1));
+	if (threads <= 1) {
+		for (int i = 0; i < n; ++i)
+			f(i);
+		return;
+	}
+
+	vector<thread> workers;
+	vector<exception_ptr> errors(threads);
+	for (int w = 0; w < threads; ++w)
+		workers.emplace_back([&, w] {
+			try {
+				for (int i = w*n/threads; i < (w+1)*n/threads; ++i)
+					f(i);
+			}
+			catch (...) {
+				errors[w] = current_exception();
+			}
+		});
+	for (thread& w : workers)
+		w.join();
+	for (const exception_ptr& e : errors)
+		if (e)
+			rethrow_exception(e);
+}
+
+// arbitrary precision integer arithmetic for exact mode, magnitudes are vectors of base 2^32 limbs
+using Limbs = vector<uint32_t>;
+constexpr size_t karatsuba_threshold = 32;			// limbs, at and above these sizes of the smaller operand
+constexpr size_t toom3_threshold = 400;				// the multiplication algorithm changes
+constexpr size_t ntt_threshold = 5000;
+constexpr uint32_t ntt_primes[2] = {998244353, 469762049};	// both are c*2^k + 1 with k >= 23
+constexpr uint32_t ntt_generator = 3;				// primitive root of both primes
+constexpr size_t ntt_max_length = size_t{1} << 23;	// largest power of two dividing both primes - 1
+constexpr int ntt_grain = 1 << 15;					// butterflies per thread
+constexpr size_t reciprocal_threshold = 64;			// limbs, below this Newton's method does not pay
+constexpr size_t decimal_threshold = 64;			// limbs, below this decimal output is by repeated division
+constexpr size_t decimal_parallel = 1 << 12;		// limbs, from this size halves are written in parallel
+constexpr int64_t max_precision = int64_t{1} << 24;	// bits of a Bigfloat
+constexpr int64_t max_exponent = int64_t{1} << 60;	// of a Bigfloat
+constexpr int64_t exact_factorial_limit = 20;		// bits, smaller integer factorials are computed exactly
+constexpr int64_t max_gamma_precision = 4096;		// bits, Spouge's sum grows quadratically with precision
+constexpr int64_t max_rational_exponent = 100000;	// of a decimal literal in rational mode
+constexpr double max_square_exponent = 1 << 20;	// complex integer powers up to this are by squaring
+constexpr uint64_t max_modular_factorial = uint64_t{1} << 24;	// multiplications for n! in modular mode
+constexpr uint64_t trial_division_limit = 1 << 10;	// factors below this are found by division
+constexpr uint64_t max_prime_count = 100000000000;	// argument of primepi
+constexpr uint64_t sieve_segment = 1 << 15;			// odd numbers sieved at a time, one byte each
+constexpr uint64_t sieve_block = 64;				// segments sieved in a row by one thread
+constexpr uint64_t combinatorics_direct = 64;		// items besides the largest group, up to this
+													// the integers above it are multiplied directly
+constexpr uint64_t max_combinatorics = uint64_t{1} << 24;	// items otherwise, or besides the largest group
+constexpr int max_fixed_scale = 18;					// so that 10^scale fits in 64 bits
+constexpr int64_t max_fixed_exponent = 4096;		// of pow in fixed mode, which is computed exactly
+constexpr int64_t decimal_powers[max_fixed_scale + 1] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000,
+	100000000000, 1000000000000, 10000000000000, 100000000000000, 1000000000000000,
+	10000000000000000, 100000000000000000, 1000000000000000000
+};
+
+void trim(Limbs& a) {
+	while (!a.empty() && a.back() == 0)
+		a.pop_back();
+}
+
+int compare(const Limbs& a, const Limbs& b) {
+	if (a.size() != b.size())
+		return a.size() < b.size() ? -1 : 1;
+	for (size_t i = a.size(); i-- > 0; )
+		if (a[i] != b[i])
+			return a[i] < b[i] ? -1 : 1;
+	return 0;
+}
+
+// number of bits in a
+int64_t bit_length(const Limbs& a) {
+	return a.empty() ? 0 : static_cast<int64_t>(32*a.size()) - countl_zero(a.back());
+}
+
+// the value of a, which must have at most two limbs
+uint64_t to_uint64(const Limbs& a) {
+	return a.empty() ? 0 : a.size() == 1 ? a[0] : uint64_t{a[1]} << 32 | a[0];
+}
+
+// a / 2^bits, truncated
+Limbs shifted_right(const Limbs& a, const int64_t bits) {
+	const size_t limbs = static_cast<size_t>(bits / 32);
+	if (limbs >= a.size())
+		return {};
+	const int s = static_cast<int>(bits % 32);
+	Limbs r(a.size() - limbs);
+	for (size_t i = 0; i < r.size(); ++i) {
+		const uint64_t next = i + limbs + 1 < a.size() ? a[i+limbs+1] : 0;
+		r[i] = static_cast<uint32_t>(((next << 32) | a[i+limbs]) >> s);
+	}
+	trim(r);
+	return r;
+}
+
+// whether any of the lowest bits of a are set
+bool low_bits_set(const Limbs& a, const int64_t bits) {
+	const size_t limbs = static_cast<size_t>(min<int64_t>(bits / 32, static_cast<int64_t>(a.size())));
+	for (size_t i = 0; i < limbs; ++i)
+		if (a[i] != 0)
+			return true;
+	const int s = static_cast<int>(bits % 32);
+	return limbs < a.size() && s != 0 && (a[limbs] & ((uint32_t{1} << s) - 1)) != 0;
+}
+
+// number of zero bits below the lowest set bit of a, which must not be zero
+int64_t trailing_zero_bits(const Limbs& a) {
+	size_t i = 0;
+	while (a[i] == 0)
+		++i;
+	return static_cast<int64_t>(32*i) + countr_zero(a[i]);
+}
+
+// add b*2^(32*shift) to a in place
+void add_to(Limbs& a, const Limbs& b, const size_t shift = 0) {
+	if (a.size() < b.size() + shift)
+		a.resize(b.size() + shift, 0);
+	uint64_t carry = 0;
+	size_t i = 0;
+	for (; i < b.size(); ++i) {
+		const uint64_t t = static_cast<uint64_t>(a[i+shift]) + b[i] + carry;
+		a[i+shift] = static_cast<uint32_t>(t);
+		carry = t >> 32;
+	}
+	for (i += shift; carry != 0; ++i) {
+		if (i == a.size())
+			a.push_back(0);
+		const uint64_t t = static_cast<uint64_t>(a[i]) + carry;
+		a[i] = static_cast<uint32_t>(t);
+		carry = t >> 32;
+	}
+}
+
+// subtract b from a in place, a must not be less than b
+void subtract_from(Limbs& a, const Limbs& b) {
+	int64_t borrow = 0;
+	for (size_t i = 0; i < a.size() && (i < b.size() || borrow != 0); ++i) {
+		int64_t t = static_cast<int64_t>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+		borrow = t < 0 ? 1 : 0;
+		if (t < 0)
+			t += int64_t{1} << 32;
+		a[i] = static_cast<uint32_t>(t);
+	}
+	trim(a);
+}
+
+// out[0, na+nb) = a*b by long multiplication, out must start zeroed
+void multiply_schoolbook(const uint32_t* a, const size_t na, const uint32_t* b, const size_t nb, uint32_t* out) {
+	for (size_t i = 0; i < na; ++i) {
+		const uint64_t ai = a[i];
+		uint64_t carry = 0;
+		for (size_t j = 0; j < nb; ++j) {
+			const uint64_t t = ai*b[j] + out[i+j] + carry;
+			out[i+j] = static_cast<uint32_t>(t);
+			carry = t >> 32;
+		}
+		out[i+nb] = static_cast<uint32_t>(carry);
+	}
+}
+
+Limbs multiply(const Limbs& a, const Limbs& b);
+
+// Karatsuba: with a = a1*B + a0 and b = b1*B + b0,
+// a*b = a1*b1*B^2 + ((a0+a1)*(b0+b1) - a0*b0 - a1*b1)*B + a0*b0
+Limbs multiply_karatsuba(const Limbs& a, const Limbs& b) {
+	const size_t m = max(a.size(), b.size()) / 2;
+	const auto low = [m](const Limbs& x) {
+		Limbs r(x.begin(), x.begin() + static_cast<ptrdiff_t>(min(m, x.size())));
+		trim(r);
+		return r;
+	};
+	const auto high = [m](const Limbs& x) {
+		return x.size() > m ? Limbs(x.begin() + static_cast<ptrdiff_t>(m), x.end()) : Limbs{};
+	};
+	const Limbs a0 = low(a);
+	const Limbs a1 = high(a);
+	const Limbs b0 = low(b);
+	const Limbs b1 = high(b);
+
+	const Limbs z0 = multiply(a0, b0);
+	const Limbs z2 = multiply(a1, b1);
+	Limbs sa = a0;
+	add_to(sa, a1);
+	Limbs sb = b0;
+	add_to(sb, b1);
+	Limbs z1 = multiply(sa, sb);
+	subtract_from(z1, z0);
+	subtract_from(z1, z2);
+
+	Limbs r = z0;
+	r.reserve(a.size() + b.size() + 1);
+	add_to(r, z1, m);
+	add_to(r, z2, 2*m);
+	trim(r);
+	return r;
+}
+
+// number theoretic transform over the prime field mod p, in place; a.size() must be a power of two.
+// p is a template argument so that the compiler can turn '% p' into multiplications
+template<uint32_t p> void ntt(vector<uint32_t>& a, const bool inverse) {
+	const auto pow_mod = [](uint64_t b, uint64_t e) {
+		uint64_t r = 1;
+		for (b %= p; e != 0; e >>= 1, b = b*b % p)
+			if (e & 1)
+				r = r*b % p;
+		return r;
+	};
+
+	const size_t n = a.size();
+	for (size_t i = 1, j = 0; i < n; ++i) {			// bit reversal permutation
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			swap(a[i], a[j]);
+	}
+
+	// roots[h+j] is w^j for the 2h-th root of unity w, for each half length h
+	vector<uint32_t> roots(n);
+	for (size_t h = 1; h < n; h <<= 1) {
+		uint64_t w = pow_mod(ntt_generator, (p - 1) / (2*h));
+		if (inverse)
+			w = pow_mod(w, p - 2);
+		uint64_t x = 1;
+		for (size_t j = 0; j < h; ++j, x = x*w % p)
+			roots[h+j] = static_cast<uint32_t>(x);
+	}
+
+	for (size_t h = 1; h < n; h <<= 1)
+		parallel_for(static_cast<int>(n/2), [&](const int k) {
+			const size_t j = k & (h-1);			// h is a power of two: no divisions here
+			const size_t i = ((k - j) << 1) + j;
+			const uint32_t u = a[i];
+			const uint32_t v = static_cast<uint32_t>(static_cast<uint64_t>(a[i+h]) * roots[h+j] % p);
+			a[i] = u + v < p ? u + v : u + v - p;
+			a[i+h] = u >= v ? u - v : u + p - v;
+		}, ntt_grain);
+
+	if (inverse) {
+		const uint64_t n_inv = pow_mod(n, p - 2);
+		for (uint32_t& x : a)
+			x = static_cast<uint32_t>(x * n_inv % p);
+	}
+}
+
+// a*b by convolution of their 16 bit halves modulo two primes, joined by the Chinese remainder theorem
+Limbs multiply_ntt(const Limbs& a, const Limbs& b) {
+	const size_t n = bit_ceil(2*(a.size() + b.size()));
+	const auto halves = [n](const Limbs& x) {
+		vector<uint32_t> r(n, 0);
+		for (size_t i = 0; i < x.size(); ++i) {
+			r[2*i] = x[i] & 0xffff;
+			r[2*i+1] = x[i] >> 16;
+		}
+		return r;
+	};
+
+	const auto convolve = [&]<uint32_t p>() {
+		vector<uint32_t> fa = halves(a);
+		vector<uint32_t> fb = halves(b);
+		ntt<p>(fa, false);
+		ntt<p>(fb, false);
+		for (size_t i = 0; i < n; ++i)
+			fa[i] = static_cast<uint32_t>(static_cast<uint64_t>(fa[i]) * fb[i] % p);
+		ntt<p>(fa, true);
+		return fa;
+	};
+	const vector<uint32_t> c[2] = {
+		convolve.template operator()<ntt_primes[0]>(),
+		convolve.template operator()<ntt_primes[1]>()};
+
+	// each coefficient is below 2^55 < p0*p1, x = c0 + p0*((c1 - c0)/p0 mod p1)
+	constexpr uint64_t p0 = ntt_primes[0];
+	constexpr uint64_t p1 = ntt_primes[1];
+	constexpr uint64_t p0_inv = 208783132;			// inverse of p0 modulo p1
+	Limbs r(a.size() + b.size() + 1, 0);
+	uint64_t carry = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t t = (c[1][i] + p1 - c[0][i] % p1) % p1 * p0_inv % p1;
+		carry += c[0][i] + t*p0;
+		const uint32_t piece = static_cast<uint32_t>(carry & 0xffff);
+		carry >>= 16;
+		if (i/2 < r.size())
+			r[i/2] |= i % 2 == 0 ? piece : piece << 16;
+	}
+	trim(r);
+	return r;
+}
+
+Limbs multiply_toom3(const Limbs& a, const Limbs& b);
+
+// a*b, choosing the algorithm by the sizes of a and b
+Limbs multiply(const Limbs& a, const Limbs& b) {
+	const Limbs& small = a.size() < b.size() ? a : b;
+	const Limbs& large = a.size() < b.size() ? b : a;
+	if (small.empty())
+		return {};
+
+	if (small.size() < karatsuba_threshold) {
+		Limbs r(a.size() + b.size(), 0);
+		multiply_schoolbook(large.data(), large.size(), small.data(), small.size(), r.data());
+		trim(r);
+		return r;
+	}
+	if (2*small.size() <= large.size()) {			// unbalanced, multiply by pieces of large
+		Limbs r;
+		for (size_t i = 0; i < large.size(); i += small.size()) {
+			Limbs piece(large.begin() + static_cast<ptrdiff_t>(i),
+						large.begin() + static_cast<ptrdiff_t>(min(i + small.size(), large.size())));
+			trim(piece);
+			add_to(r, multiply(piece, small), i);
+		}
+		trim(r);
+		return r;
+	}
+	if (small.size() >= ntt_threshold && 2*(a.size() + b.size()) <= ntt_max_length)
+		return multiply_ntt(a, b);
+	if (small.size() >= toom3_threshold)
+		return multiply_toom3(a, b);
+	return multiply_karatsuba(a, b);
+}
+
+// a / d for a single limb d, the remainder is put in rem
+Limbs divide_small(const Limbs& a, const uint32_t d, uint32_t& rem) {
+	Limbs q(a.size());
+	uint64_t r = 0;
+	for (size_t i = a.size(); i-- > 0; ) {
+		const uint64_t cur = (r << 32) | a[i];
+		q[i] = static_cast<uint32_t>(cur / d);
+		r = cur % d;
+	}
+	rem = static_cast<uint32_t>(r);
+	trim(q);
+	return q;
+}
+
+// q = a / b and r = a % b (Knuth's algorithm D), b must not be zero
+void divide(const Limbs& a, const Limbs& b, Limbs& q, Limbs& r) {
+	if (compare(a, b) < 0) {
+		q.clear();
+		r = a;
+		return;
+	}
+	if (b.size() == 1) {
+		uint32_t rem;
+		q = divide_small(a, b[0], rem);
+		r = rem == 0 ? Limbs{} : Limbs{rem};
+		return;
+	}
+
+	// normalize so that the top limb of the divisor has its high bit set
+	const int shift = countl_zero(b.back());
+	const size_t n = b.size();
+	const size_t m = a.size() - n;
+	Limbs v(n);
+	Limbs u(a.size() + 1);
+	for (size_t i = n; i-- > 0; )
+		v[i] = (b[i] << shift) | (shift != 0 && i > 0 ? b[i-1] >> (32 - shift) : 0);
+	u[a.size()] = shift != 0 ? a.back() >> (32 - shift) : 0;
+	for (size_t i = a.size(); i-- > 0; )
+		u[i] = (a[i] << shift) | (shift != 0 && i > 0 ? a[i-1] >> (32 - shift) : 0);
+
+	constexpr uint64_t base = uint64_t{1} << 32;
+	q.assign(m + 1, 0);
+	for (size_t j = m + 1; j-- > 0; ) {
+		// estimate the quotient limb from the top two limbs, it is at most 2 too large
+		const uint64_t top = (static_cast<uint64_t>(u[j+n]) << 32) | u[j+n-1];
+		uint64_t qhat = top / v[n-1];
+		uint64_t rhat = top % v[n-1];
+		while (qhat >= base || qhat*v[n-2] > ((rhat << 32) | u[j+n-2])) {
+			--qhat;
+			rhat += v[n-1];
+			if (rhat >= base)
+				break;
+		}
+
+		int64_t borrow = 0;
+		for (size_t i = 0; i < n; ++i) {
+			const uint64_t p = qhat*v[i];
+			const int64_t t = static_cast<int64_t>(u[i+j]) - borrow - static_cast<int64_t>(p & 0xffffffff);
+			u[i+j] = static_cast<uint32_t>(t);
+			borrow = static_cast<int64_t>(p >> 32) - (t >> 32);
+		}
+		const int64_t t = static_cast<int64_t>(u[j+n]) - borrow;
+		u[j+n] = static_cast<uint32_t>(t);
+
+		if (t < 0) {								// qhat was one too large, add v back
+			--qhat;
+			uint64_t carry = 0;
+			for (size_t i = 0; i < n; ++i) {
+				const uint64_t s = static_cast<uint64_t>(u[i+j]) + v[i] + carry;
+				u[i+j] = static_cast<uint32_t>(s);
+				carry = s >> 32;
+			}
+			u[j+n] += static_cast<uint32_t>(carry);
+		}
+		q[j] = static_cast<uint32_t>(qhat);
+	}
+
+	r.assign(n, 0);									// unnormalize the remainder
+	for (size_t i = 0; i < n; ++i)
+		r[i] = (u[i] >> shift) | (shift != 0 ? u[i+1] << (32 - shift) : 0);
+	trim(q);
+	trim(r);
+}
+
+Bigint::Bigint(const int64_t v)
+	:negative{v < 0} {
+	uint64_t m = v < 0 ? 0 - static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+	for (; m != 0; m >>= 32)
+		mag.push_back(static_cast<uint32_t>(m));
+}
+
+Bigint Bigint::from_unsigned(uint64_t v) {
+	Bigint r;
+	for (; v != 0; v >>= 32)
+		r.mag.push_back(static_cast<uint32_t>(v));
+	return r;
+}
+
+// the integer d, which must be whole
+Bigint Bigint::from_double(const double d) {
+	if (!isfinite(d) || d != trunc(d))
+		throw runtime_error("exact: integer expected");
+	if (abs(d) < 0x1p63)
+		return Bigint{static_cast<int64_t>(d)};
+
+	int exp;
+	const double m = frexp(abs(d), &exp);			// abs(d) = m * 2^exp, 0.5 <= m < 1
+	Bigint r{static_cast<int64_t>(ldexp(m, 53))};
+	r = r.shifted(exp - 53);
+	r.negative = d < 0;
+	return r;
+}
+
+// the nearest double, or infinity if out of range
+double Bigint::to_double() const {
+	double d = 0;
+	for (size_t i = mag.size(); i-- > 0; )
+		d = d*0x1p32 + mag[i];
+	return negative ? -d : d;
+}
+
+// this * 2^bits, bits must not be negative
+Bigint Bigint::shifted(const int bits) const {
+	Bigint r;
+	r.negative = negative;
+	r.mag.assign(bits/32, 0);
+	const int s = bits % 32;
+	uint32_t carry = 0;
+	for (const uint32_t limb : mag) {
+		r.mag.push_back((limb << s) | carry);
+		carry = s != 0 ? limb >> (32 - s) : 0;
+	}
+	r.mag.push_back(carry);
+	trim(r.mag);
+	return r;
+}
+
+Bigint operator-(const Bigint& a) {
+	Bigint r = a;
+	r.negative = !a.is_zero() && !a.negative;
+	return r;
+}
+
+Bigint operator+(const Bigint& a, const Bigint& b) {
+	Bigint r;
+	if (a.negative == b.negative) {
+		r.mag = a.mag;
+		add_to(r.mag, b.mag);
+		r.negative = a.negative;
+	}
+	else if (compare(a.mag, b.mag) >= 0) {
+		r.mag = a.mag;
+		subtract_from(r.mag, b.mag);
+		r.negative = a.negative;
+	}
+	else {
+		r.mag = b.mag;
+		subtract_from(r.mag, a.mag);
+		r.negative = b.negative;
+	}
+	if (r.is_zero())
+		r.negative = false;
+	return r;
+}
+
+Bigint operator-(const Bigint& a, const Bigint& b) {
+	return a + -b;
+}
+
+Bigint operator*(const Bigint& a, const Bigint& b) {
+	Bigint r;
+	r.mag = multiply(a.mag, b.mag);
+	r.negative = !r.is_zero() && a.negative != b.negative;
+	return r;
+}
+
+// quotient truncated towards zero, like integer division in C++
+Bigint operator/(const Bigint& a, const Bigint& b) {
+	Bigint q;
+	Limbs r;
+	divide(a.mag, b.mag, q.mag, r);
+	q.negative = !q.is_zero() && a.negative != b.negative;
+	return q;
+}
+
+// remainder with the sign of a, like fmod
+Bigint operator%(const Bigint& a, const Bigint& b) {
+	Bigint r;
+	Limbs q;
+	divide(a.mag, b.mag, q, r.mag);
+	r.negative = !r.is_zero() && a.negative;
+	return r;
+}
+
+bool operator==(const Bigint& a, const Bigint& b) {
+	return a.negative == b.negative && a.mag == b.mag;
+}
+
+// the integer written in decimal digits s
+Bigint Bigint::from_string(const string& s) {
+	Bigint r;
+	for (size_t i = 0; i < s.size(); i += 9) {
+		const string chunk = s.substr(i, 9);
+		r = r * Bigint{static_cast<int64_t>(pow(10, chunk.size()))} + Bigint{stoll(chunk)};
+	}
+	return r;
+}
+
+// a / d for a small d that divides a exactly
+Bigint divide_exact(const Bigint& a, const uint32_t d) {
+	Bigint q;
+	uint32_t rem;
+	q.mag = divide_small(a.mag, d, rem);
+	q.negative = a.negative && !q.is_zero();
+	return q;
+}
+
+// Toom-3: split a and b into three parts, evaluate them as polynomials at 0, 1, -1, -2 and
+// infinity, multiply pointwise and interpolate the product (Bodrato's sequence)
+Limbs multiply_toom3(const Limbs& a, const Limbs& b) {
+	const size_t k = (max(a.size(), b.size()) + 2) / 3;
+	const auto part = [k](const Limbs& x, const size_t i) {
+		Bigint r;
+		if (i*k < x.size())
+			r.mag.assign(x.begin() + static_cast<ptrdiff_t>(i*k),
+						  x.begin() + static_cast<ptrdiff_t>(min((i+1)*k, x.size())));
+		trim(r.mag);
+		return r;
+	};
+	const Bigint a0 = part(a, 0), a1 = part(a, 1), a2 = part(a, 2);
+	const Bigint b0 = part(b, 0), b1 = part(b, 1), b2 = part(b, 2);
+
+	const Bigint ta = a0 + a2;
+	const Bigint tb = b0 + b2;
+	const Bigint r0 = a0 * b0;
+	const Bigint r1 = (ta + a1) * (tb + b1);
+	const Bigint rm1 = (ta - a1) * (tb - b1);
+	const Bigint rm2 = (a0 - a1.shifted(1) + a2.shifted(2)) * (b0 - b1.shifted(1) + b2.shifted(2));
+	const Bigint rinf = a2 * b2;
+
+	Bigint c3 = divide_exact(rm2 - r1, 3);
+	Bigint c1 = divide_exact(r1 - rm1, 2);
+	Bigint c2 = rm1 - r0;
+	c3 = divide_exact(c2 - c3, 2) + rinf.shifted(1);
+	c2 = c2 + c1 - rinf;
+	c1 = c1 - c3;
+
+	Limbs r = r0.mag;
+	add_to(r, c1.mag, k);
+	add_to(r, c2.mag, 2*k);
+	add_to(r, c3.mag, 3*k);
+	add_to(r, rinf.mag, 4*k);
+	trim(r);
+	return r;
+}
+
+// a^n by repeated squaring
+Bigint pow(Bigint a, uint64_t n) {
+	Bigint r{1};
+	for (; n != 0; n >>= 1) {
+		if (n & 1)
+			r = r * a;
+		if (n > 1)
+			a = a * a;
+	}
+	return r;
+}
+
+// largest r with r*r <= a, by Newton's method from above, starting from the square root
+// of the leading half of a's bits so that only the last few iterations are at full size
+Bigint isqrt(const Bigint& a) {
+	if (a.is_zero())
+		return a;
+	const int bits = static_cast<int>(bit_length(a.mag));
+	const int low = bits > 104 ? bits / 4 * 2 : max(0, (bits - 52) / 2 * 2);
+	Bigint lead;
+	lead.mag = shifted_right(a.mag, low);
+	Bigint x = bits > 104 ? isqrt(lead) + Bigint{1}	// x >= sqrt(a)
+		: Bigint::from_unsigned(static_cast<uint64_t>(sqrt(lead.to_double())) + 2);
+	x = x.shifted(low / 2);
+	while (true) {
+		uint32_t rem;
+		Limbs y = divide_small((x + a / x).mag, 2, rem);
+		if (compare(y, x.mag) >= 0)
+			return x;
+		x.mag = std::move(y);
+	}
+}
+
+// product of the factors, by multiplying pairs of similar size
+Bigint product(vector<Bigint>& factors) {
+	if (factors.empty())
+		return Bigint{1};
+	while (factors.size() > 1) {
+		vector<Bigint> next;
+		for (size_t i = 0; i + 1 < factors.size(); i += 2)
+			next.push_back(factors[i] * factors[i+1]);
+		if (factors.size() % 2 == 1)
+			next.push_back(factors.back());
+		factors = std::move(next);
+	}
+	return factors[0];
+}
+
+// n! exactly: the odd parts of 1..n are multiplied in word sized chunks by a
+// balanced product tree, and the factors of two are added back by one shift
+Bigint exact_factorial(const uint32_t n) {
+	vector<Bigint> chunks;
+	uint64_t twos = 0;
+	uint64_t chunk = 1;
+	for (uint32_t i = 2; i <= n; ++i) {
+		const int z = countr_zero(i);
+		const uint64_t odd = i >> z;
+		twos += z;
+		if (chunk > numeric_limits<uint64_t>::max() / odd) {
+			chunks.push_back(Bigint::from_unsigned(chunk));
+			chunk = 1;
+		}
+		chunk *= odd;
+	}
+	chunks.push_back(Bigint::from_unsigned(chunk));
+	return product(chunks).shifted(static_cast<int>(twos));
+}
+
+// floor(B^(2n) / d) for d of n limbs and B = 2^32: one Newton step r + r*(B^(2n) - d*r)/B^(2n)
+// from the reciprocal of the top half of d, which doubles the number of correct limbs
+Limbs reciprocal(const Limbs& d) {
+	const size_t n = d.size();
+	Bigint power;
+	power.mag.assign(2*n + 1, 0);
+	power.mag.back() = 1;
+	if (n < reciprocal_threshold) {
+		Bigint q;
+		Limbs rem;
+		divide(power.mag, d, q.mag, rem);
+		return q.mag;
+	}
+
+	const size_t k = n/2 + 2;						// two guard limbs keep the error to a few units
+	Bigint r;
+	r.mag = reciprocal(Limbs(d.end() - static_cast<ptrdiff_t>(k), d.end()));
+	r.mag.insert(r.mag.begin(), n - k, 0);
+	Bigint divisor;
+	divisor.mag = d;
+
+	Bigint step = r * (power - divisor*r);
+	step.mag.erase(step.mag.begin(), step.mag.begin() + static_cast<ptrdiff_t>(min(2*n, step.mag.size())));
+	if (step.is_zero())
+		step.negative = false;
+	r = r + step;
+
+	Bigint e = power - divisor*r;					// correct the last few units
+	for (; e.negative; e = e + divisor)
+		r = r - Bigint{1};
+	for (; compare(e.mag, d) >= 0; e = e - divisor)
+		r = r + Bigint{1};
+	return r.mag;
+}
+
+// write a in decimal into the digits before end, padded with zeros to width digits
+void write_decimal(Limbs a, char* end, const size_t width) {
+	char* p = end;
+	while (!a.empty()) {
+		uint32_t rem;
+		a = divide_small(a, 1000000000, rem);
+		for (int i = 0; i < 9; ++i, rem /= 10)
+			*--p = static_cast<char>('0' + rem % 10);
+	}
+	fill(end - width, p, '0');
+}
+
+// write a < powers[k]^2 in decimal into the 2*digits(powers[k]) before end: split a by
+// powers[k] = 10^(9*2^k), using its reciprocal, and write the two halves independently
+void write_decimal(const Limbs& a, char* end, const vector<Limbs>& powers,
+				   const vector<Limbs>& reciprocals, const int k) {
+	const size_t width = size_t{18} << k;
+	if (k == 0 || a.size() < decimal_threshold) {
+		write_decimal(a, end, width);
+		return;
+	}
+
+	// q = a*reciprocal / B^(2n) is at most a few units below a / d, and the low n-2 limbs of a
+	// change it by less than one so they can be left out of the multiplication
+	const Limbs& d = powers[k];
+	const size_t low = min(d.size() - 2, a.size());
+	Limbs q = multiply(Limbs(a.begin() + static_cast<ptrdiff_t>(low), a.end()), reciprocals[k]);
+	q.erase(q.begin(), q.begin() + static_cast<ptrdiff_t>(min(2*d.size() - low, q.size())));
+	Limbs r = a;
+	subtract_from(r, multiply(q, d));
+	for (; compare(r, d) >= 0; subtract_from(r, d))
+		add_to(q, Limbs{1});
+
+	const Limbs* halves[2] = {&q, &r};
+	const auto write_half = [&](const int i) {
+		write_decimal(*halves[i], end - (1 - i)*width/2, powers, reciprocals, k - 1);
+	};
+	parallel_for(2, write_half, a.size() < decimal_parallel ? 2 : 1);
+}
+
+// write a in decimal, by divide and conquer so that huge numbers do not take quadratic time
+// (but still about ten times as long as the pow() that computed a, see bench/decimal)
+ostream& operator<<(ostream& os, const Bigint& a) {
+	if (a.is_zero())
+		return os << '0';
+	if (a.negative)
+		os << '-';
+	if (a.mag.size() < decimal_threshold) {
+		string s((a.mag.size()*10 + 8)/9*9, '0');	// whole groups of 9 digits, 2^32 < 10^10
+		write_decimal(a.mag, s.data() + s.size(), s.size());
+		return os << s.substr(min(s.find_first_not_of('0'), s.size() - 1));
+	}
+
+	vector<Limbs> powers{Limbs{1000000000}};		// powers[k] = 10^(9*2^k), up to the first with a < powers[k]^2
+	while (2*(powers.back().size() - 1) < a.mag.size())
+		powers.push_back(multiply(powers.back(), powers.back()));
+	const int top = static_cast<int>(powers.size()) - 1;
+	vector<Limbs> reciprocals(powers.size());
+	parallel_for(top + 1, [&](const int k) {
+		if (powers[k].size() >= decimal_threshold/2)
+			reciprocals[k] = reciprocal(powers[k]);
+	});
+
+	string s(size_t{18} << top, '0');
+	write_decimal(a.mag, s.data() + s.size(), powers, reciprocals, top);
+	return os << s.substr(s.find_first_not_of('0'));
+}
+
+// sets precision_bits while in scope, for intermediate results that need guard bits
+class Working_precision {
+public:
+	explicit Working_precision(const int64_t bits)
+		:saved{precision_bits} { precision_bits = bits; }
+	~Working_precision() { precision_bits = saved; }
+private:
+	int64_t saved;
+};
+
+// m * 2^e rounded to nearest even at precision_bits
+Bigfloat::Bigfloat(Bigint m, int64_t e, const bool sticky) {
+	if (const int64_t excess = bit_length(m.mag) - precision_bits; excess > 0) {
+		const bool half = (m.mag[(excess-1)/32] >> ((excess-1)%32)) & 1;
+		const bool below = sticky || low_bits_set(m.mag, excess - 1);
+		m.mag = shifted_right(m.mag, excess);
+		e += excess;
+		if (half && (below || (m.mag[0] & 1)))
+			add_to(m.mag, Limbs{1});
+	}
+	if (m.is_zero()) {
+		m.negative = false;
+		e = 0;
+	}
+	else {											// drop trailing zero bits
+		const int64_t zeros = trailing_zero_bits(m.mag);
+		m.mag = shifted_right(m.mag, zeros);
+		e += zeros;
+	}
+	if (e > max_exponent || e < -max_exponent)
+		throw runtime_error(precisionkey + ": exponent out of range");
+	mant = std::move(m);
+	exp = e;
+}
+
+Bigfloat Bigfloat::from_double(const double d) {
+	if (!isfinite(d))
+		throw runtime_error(precisionkey + ": value is not finite");
+	int e;
+	const double m = frexp(d, &e);					// d = m * 2^e, 0.5 <= |m| < 1
+	return Bigfloat{Bigint{static_cast<int64_t>(ldexp(m, 53))}, e - 53};
+}
+
+// a/b * 2^e for integers a and b, correctly rounded
+Bigfloat quotient(const Bigint& a, const Bigint& b, const int64_t e) {
+	if (a.is_zero())
+		return Bigfloat{};
+	const int64_t k = max<int64_t>(0, precision_bits + 2 + bit_length(b.mag) - bit_length(a.mag));
+	Bigint q;										// at least precision_bits + 2 bits
+	Limbs r;
+	divide(a.shifted(static_cast<int>(k)).mag, b.mag, q.mag, r);
+	q.negative = a.negative != b.negative;
+	return Bigfloat{q, e - k, !r.empty()};
+}
+
+// the digits of the decimal literal s and its exponent: s = digits * 10^exp10
+string decimal_literal(const string& s, int64_t& exp10) {
+	string digits;
+	exp10 = 0;
+	size_t i = 0;
+	for (bool fraction = false; i < s.size() && s[i] != 'e' && s[i] != 'E'; ++i)
+		if (s[i] == '.')
+			fraction = true;
+		else {
+			digits += s[i];
+			exp10 -= fraction;
+		}
+	if (i < s.size())
+		exp10 += stoll(s.substr(i + 1));
+	return digits;
+}
+
+// the decimal literal s, correctly rounded
+Bigfloat Bigfloat::from_string(const string& s) {
+	int64_t exp10 = 0;
+	const Bigint n = Bigint::from_string(decimal_literal(s, exp10));
+	if (exp10 > 10*max_precision || exp10 < -10*max_precision)
+		throw runtime_error(precisionkey + ": exponent of " + s + " out of range");
+
+	if (exp10 >= 0)
+		return Bigfloat{n * pow(Bigint{10}, exp10), 0};
+	return quotient(n, pow(Bigint{10}, -exp10), 0);
+}
+
+// the nearest double
+double Bigfloat::to_double() const {
+	Working_precision wp{53};
+	const Bigfloat r{mant, exp};
+	return ldexp(r.mant.to_double(), static_cast<int>(clamp<int64_t>(r.exp, -5000, 5000)));
+}
+
+int64_t Bigfloat::top() const {
+	return bit_length(mant.mag) + exp;
+}
+
+Bigfloat operator-(const Bigfloat& a) {
+	Bigfloat r = a;
+	r.mant = -a.mant;
+	return r;
+}
+
+Bigfloat operator+(const Bigfloat& a, const Bigfloat& b) {
+	if (a.is_zero())
+		return b;
+	if (b.is_zero())
+		return a;
+	const Bigfloat& large = a.top() >= b.top() ? a : b;
+	const Bigfloat& small = a.top() >= b.top() ? b : a;
+
+	// a small operand far below the rounding position of the sum only decides which way it
+	// rounds, any smaller value of the same sign gives the same result without a long shift
+	Bigint m = small.mant;
+	int64_t e = small.exp;
+	if (const int64_t cut = min(large.top() - precision_bits - 2, large.exp - 1); small.top() <= cut) {
+		m = Bigint{small.mant.negative ? -1 : 1};
+		e = cut - 1;
+	}
+	const int64_t low = min(large.exp, e);
+	return Bigfloat{large.mant.shifted(static_cast<int>(large.exp - low)) + m.shifted(static_cast<int>(e - low)), low};
+}
+
+Bigfloat operator-(const Bigfloat& a, const Bigfloat& b) {
+	return a + -b;
+}
+
+Bigfloat operator*(const Bigfloat& a, const Bigfloat& b) {
+	return Bigfloat{a.mant * b.mant, a.exp + b.exp};
+}
+
+// b must not be zero
+Bigfloat operator/(const Bigfloat& a, const Bigfloat& b) {
+	return quotient(a.mant, b.mant, a.exp - b.exp);
+}
+
+// a must not be negative
+Bigfloat sqrt(const Bigfloat& a) {
+	if (a.is_zero())
+		return a;
+	int64_t k = max<int64_t>(0, 2*precision_bits + 4 - bit_length(a.mant.mag));
+	if ((a.exp - k) % 2 != 0)
+		++k;
+	const Bigint m = a.mant.shifted(static_cast<int>(k));
+	const Bigint r = isqrt(m);						// at least precision_bits + 2 bits
+	return Bigfloat{r, (a.exp - k) / 2, !(r*r == m)};
+}
+
+// remainder of a / b with the sign of a, which is exact; b must not be zero
+Bigfloat fmod(const Bigfloat& a, const Bigfloat& b) {
+	Bigint ma = a.mant;
+	Bigint mb = b.mant;
+	ma.negative = mb.negative = false;
+	Bigint r;
+	if (a.exp >= b.exp) {							// ma * 2^(a.exp - b.exp) mod mb, by powers of 2 mod mb
+		r = ma % mb;
+		Bigint power = Bigint{2} % mb;
+		for (int64_t n = a.exp - b.exp; n != 0; n >>= 1) {
+			if (n & 1)
+				r = r * power % mb;
+			power = power * power % mb;
+		}
+		r.negative = a.mant.negative && !r.is_zero();
+		return Bigfloat{r, b.exp};
+	}
+	if (a.top() < b.top())
+		return a;
+	r = ma % mb.shifted(static_cast<int>(b.exp - a.exp));
+	r.negative = a.mant.negative && !r.is_zero();
+	return Bigfloat{r, a.exp};
+}
+
+// pi by Machin's formula 16 atan(1/5) - 4 atan(1/239), remembered for the last precision
+Bigfloat pi_constant() {
+	static Bigfloat pi;
+	static int64_t bits = 0;
+	if (bits == precision_bits)
+		return pi;
+
+	const auto atan_inverse = [](const int64_t n) {	// atan(1/n) by its Taylor series
+		const Bigfloat n2{n*n};
+		Bigfloat power = Bigfloat{1} / Bigfloat{n};	// 1/n^(2k+1)
+		Bigfloat sum = power;
+		for (int64_t k = 1; power.top() > -precision_bits; ++k) {
+			power = power / n2;
+			const Bigfloat t = power / Bigfloat{2*k + 1};
+			sum = k % 2 == 1 ? sum - t : sum + t;
+		}
+		return sum;
+	};
+	Bigfloat r;
+	{
+		Working_precision wp{precision_bits + 32};
+		r = Bigfloat{16}*atan_inverse(5) - Bigfloat{4}*atan_inverse(239);
+	}
+	pi = Bigfloat{r.mant, r.exp};
+	bits = precision_bits;
+	return pi;
+}
+
+// e^x, by the Taylor series of x/2^s whose sum is squared s times
+Bigfloat exp(const Bigfloat& x) {
+	if (x.is_zero())
+		return Bigfloat{1};
+	if (x.top() > 62)
+		throw runtime_error(precisionkey + ": exponent out of range");
+
+	// terms shrink by 2^-t, which balances the number of terms against the squarings
+	const int64_t t = static_cast<int64_t>(sqrt(static_cast<double>(precision_bits)));
+	const int64_t s = max<int64_t>(0, x.top() + t);
+	Bigfloat sum{1};
+	{
+		Working_precision wp{precision_bits + s + 32};
+		Bigfloat y = x;
+		y.exp -= s;
+		Bigfloat term{1};
+		for (int64_t k = 1; !term.is_zero() && term.top() > -precision_bits; ++k) {
+			term = term * y / Bigfloat{k};
+			sum = sum + term;
+		}
+		for (int64_t i = 0; i < s; ++i)
+			sum = sum * sum;
+	}
+	return Bigfloat{sum.mant, sum.exp};
+}
+
+// natural logarithm of x > 0, by Newton's iteration y + 2(x - e^y)/(x + e^y) from the
+// logarithm of x's leading bits as a double, doubling the precision at each step
+Bigfloat log(const Bigfloat& x) {
+	const Bigfloat one{1};
+	const Bigfloat d = x - one;
+	if (d.is_zero())
+		return d;
+	const int64_t guard = max<int64_t>(0, -d.top()) + 32;	// close to 1 the log is small
+
+	const int64_t len = bit_length(x.mant.mag);
+	const int64_t head = min<int64_t>(len, 60);
+	Bigint lead;
+	lead.mag = shifted_right(x.mant.mag, len - head);
+	Bigfloat y = guard > 32 ? Bigfloat::from_double(log1p(d.to_double()))
+		: Bigfloat::from_double(log(lead.to_double()) + static_cast<double>(x.exp + len - head) * numbers::ln2);
+
+	vector<int64_t> steps;
+	for (int64_t bits = precision_bits; bits > 48; bits /= 2)
+		steps.push_back(bits);
+	for (auto bits = steps.rbegin(); bits != steps.rend(); ++bits) {
+		Working_precision wp{*bits + guard};
+		const Bigfloat ey = exp(y);
+		y = y + Bigfloat{2} * (x - ey) / (x + ey);
+	}
+	return Bigfloat{y.mant, y.exp};
+}
+
+// a^b: by repeated squaring for integer b, otherwise e^(b log a) for a > 0
+Bigfloat pow(const Bigfloat& a, const Bigfloat& b) {
+	if (b.is_zero())
+		return Bigfloat{1};
+	Bigfloat r{1};
+	if (b.is_integer() && b.top() < 63) {
+		const Limbs n = b.mant.shifted(static_cast<int>(b.exp)).mag;
+		uint64_t m = n[0] | (n.size() > 1 ? static_cast<uint64_t>(n[1]) << 32 : 0);
+		{
+			Working_precision wp{precision_bits + 2*bit_length(n) + 32};
+			for (Bigfloat power = a; m != 0; m >>= 1) {
+				if (m & 1)
+					r = r * power;
+				if (m > 1)
+					power = power * power;
+			}
+			if (b.mant.negative) {
+				if (r.is_zero())
+					throw runtime_error("pow: zero to a negative power");
+				r = Bigfloat{1} / r;
+			}
+		}
+		return Bigfloat{r.mant, r.exp};
+	}
+	if (a.is_zero()) {
+		if (b.mant.negative)
+			throw runtime_error("pow: zero to a negative power");
+		return a;
+	}
+	if (a.mant.negative)
+		throw runtime_error("pow: negative number to a fractional power");
+	{
+		// |b log a| < 2^(b.top() + bit_width(|a.top()|)), e^y loses the bits of y's integer part
+		const int64_t magnitude = b.top() + static_cast<int64_t>(bit_width(static_cast<uint64_t>(abs(a.top()))));
+		Working_precision wp{precision_bits + 32 + max<int64_t>(0, magnitude)};
+		r = exp(b * log(a));
+	}
+	return Bigfloat{r.mant, r.exp};
+}
+
+// x! = gamma(x + 1): exactly and then rounded for small integers, otherwise by Spouge's
+// approximation with a - 1 terms, whose relative error is below (2 pi)^-a
+Bigfloat factorial(const Bigfloat& x) {
+	if (x.mant.negative)
+		throw runtime_error("cannot get factorial of negative number.");
+	if (x.is_integer() && x.top() <= exact_factorial_limit)
+		return Bigfloat{exact_factorial(x.is_zero() ? 0 : x.mant.shifted(static_cast<int>(x.exp)).mag[0]), 0};
+	if (precision_bits > max_gamma_precision)
+		throw runtime_error("!: argument must be an integer below 2^" + to_string(exact_factorial_limit)
+			+ " at more than " + to_string(max_gamma_precision) + " bits");
+
+	const int64_t a = static_cast<int64_t>(ceil(static_cast<double>(precision_bits) * numbers::ln2
+		/ log(2*numbers::pi))) + 1;
+	Bigfloat r;
+	{
+		Working_precision wp{precision_bits + 2*a + 32};	// the terms alternate and reach e^a
+		const Bigfloat one{1};
+		const Bigfloat e_inverse = exp(-one);
+		Bigfloat e_power = pow(exp(one), Bigfloat{a - 1});	// e^(a-k)
+		Bigfloat k_factorial{1};					// (k-1)!
+		Bigfloat sum = sqrt(Bigfloat{2} * pi_constant());
+		for (int64_t k = 1; k < a; ++k) {
+			const Bigfloat ak{a - k};
+			const Bigfloat c = pow(ak, Bigfloat{k - 1}) * sqrt(ak) * e_power / k_factorial / (x + Bigfloat{k});
+			sum = k % 2 == 1 ? sum + c : sum - c;
+			e_power = e_power * e_inverse;
+			k_factorial = k_factorial * Bigfloat{k};
+		}
+		const Bigfloat xa = x + Bigfloat{a};
+		r = pow(xa, x + one / Bigfloat{2}) * exp(-xa) * sum;
+	}
+	return Bigfloat{r.mant, r.exp};
+}
+
+// write x with as many significant digits as its precision supports, in the format of a double
+ostream& operator<<(ostream& os, const Bigfloat& x) {
+	if (x.is_zero())
+		return os << '0';
+	const int64_t digits = max<int64_t>(1, static_cast<int64_t>(static_cast<double>(precision_bits) * log10(2.0)));
+	Bigfloat a = x;
+	a.mant.negative = false;
+
+	// scale a to an integer of digits digits, the estimated decimal exponent can be one off
+	int64_t e10 = static_cast<int64_t>(floor(static_cast<double>(a.top() - 1) * log10(2.0)));
+	string s;
+	while (true) {
+		const int64_t shift = digits - 1 - e10;
+		Bigfloat y;
+		{
+			Working_precision wp{precision_bits + 64 + static_cast<int64_t>(bit_width(static_cast<uint64_t>(abs(shift))))};
+			const Bigfloat scale = pow(Bigfloat{10}, Bigfloat{abs(shift)});
+			y = shift >= 0 ? a * scale : a / scale;
+		}
+		{
+			Working_precision wp{max<int64_t>(1, y.top())};
+			y = Bigfloat{y.mant, y.exp};			// nearest integer
+		}
+		ostringstream digits_of_y;
+		digits_of_y << y.mant.shifted(static_cast<int>(y.exp));
+		s = digits_of_y.str();
+		if (static_cast<int64_t>(s.size()) == digits)
+			break;
+		e10 += static_cast<int64_t>(s.size()) > digits ? 1 : -1;
+	}
+	s.erase(s.find_last_not_of('0') + 1);
+
+	if (x.mant.negative)
+		os << '-';
+	if (e10 < -5 || e10 >= digits) {
+		os << s[0];
+		if (s.size() > 1)
+			os << '.' << s.substr(1);
+		return os << 'e' << (e10 < 0 ? '-' : '+') << (abs(e10) < 10 ? "0" : "") << abs(e10);
+	}
+	if (e10 < 0)
+		return os << "0." << string(-e10 - 1, '0') << s;
+	if (static_cast<int64_t>(s.size()) <= e10 + 1)
+		return os << s << string(e10 + 1 - s.size(), '0');
+	return os << s.substr(0, e10 + 1) << '.' << s.substr(e10 + 1);
+}
+
+using uint128 = unsigned __int128;					// GCC and Clang extension, for products of 64 bit values
+using int128 = __int128;
+
+int trailing_zero_bits(const uint64_t a) { return countr_zero(a); }
+
+int trailing_zero_bits(const uint128 a) {
+	const uint64_t low = static_cast<uint64_t>(a);
+	return low != 0 ? countr_zero(low) : 64 + countr_zero(static_cast<uint64_t>(a >> 64));
+}
+
+// greatest common divisor by Stein's binary algorithm, which only shifts and subtracts
+template<class U> U binary_gcd(U a, U b) {
+	if (a == 0 || b == 0)
+		return a | b;
+	const int twos = trailing_zero_bits(a | b);
+	a >>= trailing_zero_bits(a);
+	while (b != 0) {								// a is odd
+		b >>= trailing_zero_bits(b);
+		if (a > b)
+			swap(a, b);
+		b -= a;
+	}
+	return a << twos;
+}
+
+// greatest common divisor of magnitudes by the binary algorithm, with a division
+// step instead whenever one operand is more than a limb longer than the other
+Limbs binary_gcd(Limbs a, Limbs b) {
+	if (a.empty() || b.empty())
+		return a.empty() ? b : a;
+	const int64_t twos = min(trailing_zero_bits(a), trailing_zero_bits(b));
+	a = shifted_right(a, trailing_zero_bits(a));
+	while (!b.empty()) {							// a is odd
+		b = shifted_right(b, trailing_zero_bits(b));
+		if (compare(a, b) > 0)
+			swap(a, b);
+		if (b.size() > a.size() + 1) {
+			Limbs q, r;
+			divide(b, a, q, r);
+			b = std::move(r);
+		}
+		else
+			subtract_from(b, a);
+	}
+	Bigint g;
+	g.mag = std::move(a);
+	return g.shifted(static_cast<int>(twos)).mag;
+}
+
+bool fits_int64(const int128 v) { return v >= -numeric_limits<int64_t>::max() && v <= numeric_limits<int64_t>::max(); }
+
+// v as a Bigint, for values beyond 64 bits
+Bigint to_bigint(const int128 v) {
+	uint128 m = v < 0 ? -static_cast<uint128>(v) : static_cast<uint128>(v);
+	Bigint r;
+	r.negative = v < 0;
+	for (; m != 0; m >>= 32)
+		r.mag.push_back(static_cast<uint32_t>(m));
+	return r;
+}
+
+// n/d in lowest terms, d must not be zero
+Rational::Rational(Bigint n, Bigint d) {
+	if (d.negative) {
+		n.negative = !n.negative && !n.is_zero();
+		d.negative = false;
+	}
+	Bigint g;
+	g.mag = binary_gcd(n.mag, d.mag);
+	if (g.mag.size() > 1 || g.mag[0] != 1) {
+		n = n / g;
+		d = d / g;
+	}
+	*this = from_lowest_terms(std::move(n), std::move(d));
+}
+
+// n/d for positive d, in 64 bits if both fit
+Rational Rational::from_lowest_terms(Bigint n, Bigint d) {
+	Rational r;
+	if (n.mag.size() <= 2 && d.mag.size() <= 2 && bit_length(n.mag) < 64 && bit_length(d.mag) < 64) {
+		r.num = static_cast<int64_t>(to_uint64(n.mag));
+		r.num = n.negative ? -r.num : r.num;
+		r.den = static_cast<int64_t>(to_uint64(d.mag));
+		return r;
+	}
+	r.small = false;
+	r.big_num = std::move(n);
+	r.big_den = std::move(d);
+	return r;
+}
+
+// n/d for 128 bit results of 64 bit operands, d > 0; it is kept as it is if it fits in
+// 64 bits, otherwise reduced first
+Rational small_rational(int128 n, int128 d) {
+	if (!fits_int64(n) || !fits_int64(d)) {
+		const uint128 g = binary_gcd(n < 0 ? -static_cast<uint128>(n) : static_cast<uint128>(n), static_cast<uint128>(d));
+		n /= static_cast<int128>(g);
+		d /= static_cast<int128>(g);
+		if (!fits_int64(n) || !fits_int64(d))
+			return Rational::from_lowest_terms(to_bigint(n), to_bigint(d));
+	}
+	Rational r;
+	r.num = static_cast<int64_t>(n);
+	r.den = static_cast<int64_t>(d);
+	return r;
+}
+
+// r in lowest terms
+Rational reduced(Rational r) {
+	if (r.small) {
+		const int64_t g = static_cast<int64_t>(binary_gcd(static_cast<uint64_t>(abs(r.num)), static_cast<uint64_t>(r.den)));
+		r.num /= g;
+		r.den /= g;
+	}
+	return r;
+}
+
+Rational operator-(const Rational& a) {
+	Rational r = a;
+	r.num = -r.num;
+	r.big_num = -r.big_num;
+	return r;
+}
+
+// the double d exactly as the shortest decimal that reads back as d, so that a
+// variable set to 0.1 is 1/10 again
+Rational Rational::from_double(const double d) {
+	if (!isfinite(d))
+		throw runtime_error(rationalkey + ": value is not finite");
+	char buffer[32];
+	const auto [end, error] = to_chars(buffer, buffer + sizeof buffer, abs(d));
+	const Rational r = from_string(string(buffer, end));
+	return d < 0 ? -r : r;
+}
+
+// the decimal literal s exactly
+Rational Rational::from_string(const string& s) {
+	int64_t exp10 = 0;
+	const string digits = decimal_literal(s, exp10);
+	if (exp10 >= -18 && static_cast<int64_t>(digits.size()) + max<int64_t>(exp10, 0) <= 18) {	// fits in 64 bits
+		int64_t scale = 1;
+		for (int64_t i = 0; i < abs(exp10); ++i)
+			scale *= 10;
+		return exp10 >= 0 ? Rational{stoll(digits) * scale} : small_rational(stoll(digits), scale);
+	}
+	if (exp10 > max_rational_exponent || exp10 < -max_rational_exponent)
+		throw runtime_error(rationalkey + ": exponent of " + s + " out of range");
+	const Bigint n = Bigint::from_string(digits);
+	if (exp10 >= 0)
+		return Rational{n * pow(Bigint{10}, exp10), Bigint{1}};
+	return Rational{n, pow(Bigint{10}, -exp10)};
+}
+
+// the nearest double, or infinity if out of range
+double Rational::to_double() const {
+	Working_precision wp{53};
+	return quotient(numerator(), denominator(), 0).to_double();
+}
+
+Bigint gcd(const Bigint& a, const Bigint& b) {
+	Bigint g;
+	g.mag = binary_gcd(a.mag, b.mag);
+	return g;
+}
+
+// beyond 64 bits the operands are in lowest terms, and the results are kept so by
+// Henrici's method: only gcds of smaller numbers than the result's are needed
+
+Rational operator+(const Rational& a, const Rational& b) {
+	if (a.small && b.small) {
+		if (a.den == b.den)
+			return small_rational(int128{a.num} + b.num, a.den);
+		return small_rational(int128{a.num}*b.den + int128{b.num}*a.den, int128{a.den}*b.den);
+	}
+	const Rational x = reduced(a);
+	const Rational y = reduced(b);
+	const Bigint g = gcd(x.denominator(), y.denominator());
+	const Bigint t = x.numerator()*(y.denominator() / g) + y.numerator()*(x.denominator() / g);
+	if (t.is_zero())
+		return Rational{};
+	const Bigint h = gcd(t, g);
+	return Rational::from_lowest_terms(t / h, (x.denominator() / g) * (y.denominator() / h));
+}
+
+Rational operator-(const Rational& a, const Rational& b) {
+	return a + -b;
+}
+
+Rational operator*(const Rational& a, const Rational& b) {
+	if (a.small && b.small)
+		return small_rational(int128{a.num}*b.num, int128{a.den}*b.den);
+	const Rational x = reduced(a);
+	const Rational y = reduced(b);
+	if (x.is_zero() || y.is_zero())
+		return Rational{};
+	const Bigint g = gcd(x.numerator(), y.denominator());
+	const Bigint h = gcd(y.numerator(), x.denominator());
+	return Rational::from_lowest_terms((x.numerator() / g) * (y.numerator() / h),
+		(x.denominator() / h) * (y.denominator() / g));
+}
+
+// b must not be zero
+Rational operator/(const Rational& a, const Rational& b) {
+	if (a.small && b.small) {
+		const int128 n = int128{a.num}*b.den;
+		const int128 d = int128{a.den}*b.num;
+		return d < 0 ? small_rational(-n, -d) : small_rational(n, d);
+	}
+	const Rational y = reduced(b);
+	Bigint n = y.denominator();
+	Bigint d = y.numerator();
+	n.negative = d.negative;
+	d.negative = false;
+	return a * Rational::from_lowest_terms(std::move(n), std::move(d));
+}
+
+// write r in lowest terms as n/d, or n if it is an integer
+ostream& operator<<(ostream& os, const Rational& r) {
+	const Rational a = reduced(r);
+	if (a.small)
+		return a.den == 1 ? os << a.num : os << a.num << '/' << a.den;
+	return a.big_den == Bigint{1} ? os << a.big_num : os << a.big_num << '/' << a.big_den;
+}
+
+// n/d rounded half to even
+template<class I> I round_half_even(const I n, const I d) {
+	I q = n / d;
+	const I r = n % d < 0 ? -(n % d) : n % d;
+	const I rest = (d < 0 ? -d : d) - r;			// r > rest if above half, without overflow
+	if (r > rest || (r == rest && q % 2 != 0))
+		q += (n < 0) != (d < 0) ? -1 : 1;
+	return q;
+}
+
+// n/d rounded half to even, in 64 bits where n fits as 128 bit division is a slow library call
+int128 round_half_even(const int128 n, const int64_t d) {
+	if (fits_int64(n))
+		return round_half_even(static_cast<int64_t>(n), d);
+	return round_half_even(n, int128{d});
+}
+
+// v as the raw value of a Fixed, which must fit in 64 bits
+Fixed fixed_result(const int128 v) {
+	if (!fits_int64(v))
+		throw runtime_error(fixedkey + ": overflow");
+	return Fixed{static_cast<int64_t>(v)};
+}
+
+// r rounded half to even to fixed_scale decimals
+Fixed Fixed::from_rational(const Rational& r) {
+	if (r.small)
+		return fixed_result(round_half_even(int128{r.num} * decimal_powers[fixed_scale], r.den));
+	Limbs q, rem;
+	const Bigint n = r.big_num * Bigint{decimal_powers[fixed_scale]};
+	divide(n.mag, r.big_den.mag, q, rem);
+	Limbs twice = rem;
+	add_to(twice, rem);
+	if (const int c = compare(twice, r.big_den.mag); c > 0 || (c == 0 && !q.empty() && (q[0] & 1)))
+		add_to(q, Limbs{1});
+	if (q.size() > 2 || bit_length(q) > 63)
+		throw runtime_error(fixedkey + ": overflow");
+	const int64_t v = static_cast<int64_t>(to_uint64(q));
+	return Fixed{n.negative ? -v : v};
+}
+
+Fixed Fixed::from_double(const double d) {
+	return from_rational(Rational::from_double(d));
+}
+
+// write x with fixed_scale decimals
+ostream& operator<<(ostream& os, const Fixed x) {
+	const uint64_t m = x.v < 0 ? 0 - static_cast<uint64_t>(x.v) : static_cast<uint64_t>(x.v);
+	const uint64_t unit = static_cast<uint64_t>(decimal_powers[fixed_scale]);
+	if (x.v < 0)
+		os << '-';
+	os << m / unit;
+	if (fixed_scale == 0)
+		return os;
+	const string fraction = to_string(m % unit);
+	return os << '.' << string(fixed_scale - fraction.size(), '0') << fraction;
+}
+
+// the nearest double
+double Fixed::to_double() const {
+	ostringstream os;
+	os << *this;
+	return stod(os.str());
+}
+
+Fixed operator-(const Fixed a) {
+	return fixed_result(-int128{a.v});
+}
+
+Fixed operator+(const Fixed a, const Fixed b) {
+	Fixed r;
+	if (__builtin_add_overflow(a.v, b.v, &r.v))
+		throw runtime_error(fixedkey + ": overflow");
+	return r;
+}
+
+Fixed operator-(const Fixed a, const Fixed b) {
+	Fixed r;
+	if (__builtin_sub_overflow(a.v, b.v, &r.v))
+		throw runtime_error(fixedkey + ": overflow");
+	return r;
+}
+
+Fixed operator*(const Fixed a, const Fixed b) {
+	return fixed_result(round_half_even(int128{a.v} * b.v, decimal_powers[fixed_scale]));
+}
+
+// b must not be zero
+Fixed operator/(const Fixed a, const Fixed b) {
+	return fixed_result(round_half_even(int128{a.v} * decimal_powers[fixed_scale], b.v));
+}
+
+// remainder with the sign of a, exact; b must not be zero
+Fixed operator%(const Fixed a, const Fixed b) {
+	return Fixed{b.v == -1 ? 0 : a.v % b.v};
+}
+
+// arithmetic modulo an odd m in Montgomery form x * 2^64 mod m, in which the
+// reduction after a product takes two multiplications instead of a division
+class Montgomery {
+public:
+	explicit Montgomery(uint64_t modulus);
+	uint64_t to(const uint64_t x) const { return reduce(static_cast<uint128>(x % m) * r2); }
+	uint64_t from(const uint64_t x) const { return reduce(x); }
+	uint64_t multiply(const uint64_t a, const uint64_t b) const { return reduce(static_cast<uint128>(a) * b); }
+	uint64_t power(uint64_t x, uint64_t e) const;	// x^e, with x and the result in Montgomery form
+private:
+	uint64_t m;
+	uint64_t inverse;								// m^-1 mod 2^64
+	uint64_t r2;									// 2^128 mod m
+	uint64_t reduce(uint128 t) const;				// t / 2^64 mod m for t < m * 2^64
+};
+
+Montgomery::Montgomery(const uint64_t modulus)
+	:m{modulus}, inverse{modulus} {
+	for (int i = 0; i < 5; ++i)						// Newton's iteration doubles the correct low bits from 3
+		inverse *= 2 - m*inverse;
+	const uint64_t r = (0 - m) % m;					// 2^64 mod m
+	r2 = static_cast<uint64_t>(static_cast<uint128>(r) * r % m);
+}
+
+uint64_t Montgomery::reduce(const uint128 t) const {
+	const uint64_t q = static_cast<uint64_t>(t) * inverse;	// q*m agrees with t in the low 64 bits
+	const uint64_t high = static_cast<uint64_t>((static_cast<uint128>(q) * m) >> 64);
+	const uint64_t th = static_cast<uint64_t>(t >> 64);
+	return th >= high ? th - high : th - high + m;
+}
+
+uint64_t Montgomery::power(uint64_t x, uint64_t e) const {
+	uint64_t r = to(1);
+	for (; e != 0; e >>= 1) {
+		if (e & 1)
+			r = multiply(r, x);
+		x = multiply(x, x);
+	}
+	return r;
+}
+
+// b^e for e given by its bits, by left to right sliding windows: squarings for every
+// bit, but a multiplication by one of the precomputed odd powers only once per window
+template<class T, class Mul> T window_power(const T& b, const T& one, const Limbs& e, Mul mul) {
+	const int64_t bits = bit_length(e);
+	const int w = bits > 671 ? 6 : bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : bits > 6 ? 2 : 1;
+	const auto bit = [&](const int64_t i) { return (e[static_cast<size_t>(i) / 32] >> (i % 32)) & 1; };
+
+	array<T, 32> odd;								// b, b^3, b^5, ..., b^(2^w - 1)
+	odd[0] = b;
+	if (w > 1) {
+		const T b2 = mul(b, b);
+		for (int k = 1; k < (1 << (w - 1)); ++k)
+			odd[k] = mul(odd[k-1], b2);
+	}
+	T r = one;
+	bool started = false;							// r is still one, so squaring is not needed
+	for (int64_t i = bits - 1; i >= 0; ) {
+		if (!bit(i)) {
+			if (started)
+				r = mul(r, r);
+			--i;
+			continue;
+		}
+		int64_t j = max<int64_t>(i - w + 1, 0);		// the window is bits i to j, ending in a one
+		while (!bit(j))
+			++j;
+		uint32_t value = 0;
+		for (int64_t k = i; k >= j; --k) {
+			value = value << 1 | bit(k);
+			if (started)
+				r = mul(r, r);
+		}
+		r = started ? mul(r, odd[value / 2]) : odd[value / 2];
+		started = true;
+		i = j - 1;
+	}
+	return r;
+}
+
+// b^e mod m for a 64 bit modulus m > 0
+uint64_t powmod(const uint64_t b, const Limbs& e, const uint64_t m) {
+	if (m == 1)
+		return 0;
+	if (m % 2 == 0)									// Montgomery needs an odd modulus
+		return window_power(b % m, uint64_t{1}, e, [m](const uint64_t x, const uint64_t y) {
+			return static_cast<uint64_t>(static_cast<uint128>(x) * y % m);
+		});
+	const Montgomery mont{m};
+	return mont.from(window_power(mont.to(b), mont.to(1), e, [&mont](const uint64_t x, const uint64_t y) {
+		return mont.multiply(x, y);
+	}));
+}
+
+// a * b / 2^(32n) mod m for the n limbs of odd m and a, b < m, by Montgomery's
+// interleaved multiplication and reduction; m_inverse is -m^-1 mod 2^32
+Limbs montgomery_multiply(const Limbs& a, const Limbs& b, const Limbs& m, const uint32_t m_inverse) {
+	const size_t n = m.size();
+	Limbs t(n + 2, 0);
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t ai = i < a.size() ? a[i] : 0;
+		uint64_t carry = 0;
+		for (size_t j = 0; j < n; ++j) {
+			const uint64_t x = t[j] + ai * (j < b.size() ? b[j] : 0) + carry;
+			t[j] = static_cast<uint32_t>(x);
+			carry = x >> 32;
+		}
+		uint64_t x = t[n] + carry;
+		t[n] = static_cast<uint32_t>(x);
+		t[n+1] = static_cast<uint32_t>(x >> 32);
+
+		const uint64_t u = static_cast<uint32_t>(t[0] * m_inverse);	// makes the low limb zero
+		carry = (t[0] + u * m[0]) >> 32;
+		for (size_t j = 1; j < n; ++j) {
+			x = t[j] + u * m[j] + carry;
+			t[j-1] = static_cast<uint32_t>(x);
+			carry = x >> 32;
+		}
+		x = t[n] + carry;
+		t[n-1] = static_cast<uint32_t>(x);
+		t[n] = t[n+1] + static_cast<uint32_t>(x >> 32);
+		t[n+1] = 0;
+	}
+	trim(t);
+	if (compare(t, m) >= 0)
+		subtract_from(t, m);
+	return t;
+}
+
+// b^e mod m for m > 0 and e >= 0
+Bigint powmod(const Bigint& b, const Bigint& e, const Bigint& m) {
+	Bigint base = b % m;							// with the sign of b
+	if (base.negative)
+		base = base + m;
+	if (m.mag.size() <= 2)
+		return Bigint::from_unsigned(powmod(to_uint64(base.mag), e.mag, to_uint64(m.mag)));
+	if (m.mag[0] % 2 == 0)
+		return window_power(base, Bigint{1}, e.mag, [&m](const Bigint& x, const Bigint& y) { return x*y % m; });
+
+	uint32_t inverse = m.mag[0];					// Newton's iteration as in Montgomery's constructor
+	for (int i = 0; i < 4; ++i)
+		inverse *= 2 - m.mag[0]*inverse;
+	const int r = static_cast<int>(32*m.mag.size());	// Montgomery form is x * 2^r mod m
+	const auto mul = [&m, inverse](const Limbs& x, const Limbs& y) { return montgomery_multiply(x, y, m.mag, 0 - inverse); };
+	const Limbs p = window_power((base.shifted(r) % m).mag, (Bigint{1}.shifted(r) % m).mag, e.mag, mul);
+	Bigint result;
+	result.mag = mul(p, Limbs{1});
+	return result;
+}
+
+// b^e mod m for integers held in doubles, exact for moduli up to 2^53
+double powmod(const double b, const double e, const double m) {
+	for (const double x : {b, e, m})
+		if (!isfinite(x) || x != trunc(x))
+			throw runtime_error(powmodkey + ": integer arguments expected");
+	if (e < 0)
+		throw runtime_error(powmodkey + ": negative exponent");
+	if (m < 1 || m > 0x1p53)
+		throw runtime_error(powmodkey + ": modulus from 1 to 2^53 expected, " + modekey + " " + exactkey
+			+ " takes larger ones");
+	const double base = fmod(b, m);				// exact
+	return static_cast<double>(powmod(static_cast<uint64_t>(base < 0 ? base + m : base), Bigint::from_double(e).mag,
+		static_cast<uint64_t>(m)));
+}
+
+// a step function, with derivative zero
+Dual powmod(const Dual& b, const Dual& e, const Dual& m) {
+	return Dual{powmod(b.v, e.v, m.v)};
+}
+
+// Miller-Rabin with Sinclair's seven bases, which leave no 64 bit composite undetected
+bool is_prime(const uint64_t n) {
+	constexpr uint64_t small_primes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	constexpr uint64_t bases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+	if (n < 2)
+		return false;
+	for (const uint64_t p : small_primes)
+		if (n % p == 0)
+			return n == p;
+	if (n < 41*41)
+		return true;
+
+	const Montgomery mont{n};
+	const int s = trailing_zero_bits(n - 1);		// n - 1 = d * 2^s with d odd
+	const uint64_t d = (n - 1) >> s;
+	const uint64_t one = mont.to(1);
+	const uint64_t minus_one = mont.to(n - 1);
+	for (const uint64_t a : bases) {
+		if (a % n == 0)
+			continue;
+		uint64_t x = mont.power(mont.to(a), d);
+		if (x == one || x == minus_one)
+			continue;
+		for (int i = 1; i < s && x != minus_one; ++i)
+			x = mont.multiply(x, x);
+		if (x != minus_one)
+			return false;							// a witnesses that n is composite
+	}
+	return true;
+}
+
+// the smallest prime above n
+uint64_t next_prime(const uint64_t n) {
+	constexpr uint64_t largest = 18446744073709551557u;	// the largest prime below 2^64
+	if (n >= largest)
+		throw runtime_error(nextprimekey + ": no prime above " + to_string(n) + " below 2^64");
+	if (n < 2)
+		return 2;
+	uint64_t p = n + 1 + n % 2;						// odd candidates only
+	while (!is_prime(p))
+		p += 2;
+	return p;
+}
+
+// a nontrivial factor of the odd composite n by Pollard's rho with Brent's cycle detection,
+// iterating x^2 + c in Montgomery form and taking the gcd of a product of many differences
+uint64_t pollard_rho(const uint64_t n) {
+	constexpr uint64_t batch = 128;					// differences multiplied per gcd
+	const Montgomery mont{n};
+	for (uint64_t c = 1; ; ++c) {
+		const uint64_t cm = mont.to(c);
+		const auto f = [&](const uint64_t x) {		// x^2 + c mod n, without overflow for n near 2^64
+			const uint64_t y = mont.multiply(x, x);
+			return y >= n - cm ? y - (n - cm) : y + cm;
+		};
+		const auto distance = [](const uint64_t a, const uint64_t b) { return a > b ? a - b : b - a; };
+
+		uint64_t x = 0;
+		uint64_t y = mont.to(2);
+		uint64_t saved = y;							// y at the start of the last batch
+		uint64_t q = mont.to(1);
+		uint64_t g = 1;
+		for (uint64_t r = 1; g == 1; r *= 2) {
+			x = y;
+			for (uint64_t i = 0; i < r; ++i)
+				y = f(y);
+			for (uint64_t k = 0; k < r && g == 1; k += batch) {
+				saved = y;
+				for (uint64_t i = 0; i < min(batch, r - k); ++i) {
+					y = f(y);
+					q = mont.multiply(q, distance(x, y));
+				}
+				g = binary_gcd(q, n);				// q has the factors of the plain product, as 2^64 is prime to n
+			}
+		}
+		if (g == n)									// several factors in one batch, redo it a step at a time
+			do {
+				saved = f(saved);
+				g = binary_gcd(distance(x, saved), n);
+			} while (g == 1);
+		if (g != n)
+			return g;
+	}
+}
+
+// the prime factors of n > 0 in increasing order, with repetitions
+vector<uint64_t> prime_factors(uint64_t n) {
+	vector<uint64_t> factors;
+	for (uint64_t p = 2; p < trial_division_limit && p*p <= n; p += 1 + p % 2)
+		for (; n % p == 0; n /= p)
+			factors.push_back(p);
+
+	vector<uint64_t> rest{n};						// cofactors still to be split
+	while (!rest.empty()) {
+		const uint64_t m = rest.back();
+		rest.pop_back();
+		if (m == 1)
+			continue;
+		if (is_prime(m)) {
+			factors.push_back(m);
+			continue;
+		}
+		const uint64_t d = pollard_rho(m);
+		rest.push_back(d);
+		rest.push_back(m / d);
+	}
+	ranges::sort(factors);
+	return factors;
+}
+
+// the primes up to n, by the sieve of Eratosthenes on the odd numbers
+vector<uint64_t> primes_up_to(const uint64_t n) {
+	vector<uint64_t> primes;
+	if (n < 2)
+		return primes;
+	primes.push_back(2);
+	vector<uint8_t> composite(n/2 + 1);				// odd number 2i + 1 has index i
+	for (uint64_t i = 1; 2*i + 1 <= n; ++i)
+		if (!composite[i]) {
+			const uint64_t p = 2*i + 1;
+			primes.push_back(p);
+			for (uint64_t k = p*p/2; k <= n/2; k += p)
+				composite[k] = 1;
+		}
+	return primes;
+}
+
+// the number of primes up to n, by a sieve of the odd numbers in segments that fit the
+// cache; blocks of segments are sieved in parallel, each keeping the next multiple of
+// every base prime from one segment to the next. The multiples of the smallest primes,
+// half of all crossings out, are copied from a pattern that repeats with their product
+uint64_t prime_pi(const uint64_t n) {
+	if (n > max_prime_count)
+		throw runtime_error(primepikey + ": argument above " + to_string(max_prime_count));
+	if (n < 3)
+		return n < 2 ? 0 : 1;
+
+	constexpr uint64_t wheel[] = {3, 5, 7, 11, 13};
+	constexpr uint64_t period = 3*5*7*11*13;
+	vector<uint8_t> pattern(period + sieve_segment);	// so that any segment is one copy
+	for (const uint64_t p : wheel)
+		for (uint64_t k = p/2; k < pattern.size(); k += p)
+			pattern[k] = 1;
+
+	vector<uint64_t> base = primes_up_to(static_cast<uint64_t>(sqrt(static_cast<double>(n))));
+	erase_if(base, [&wheel](const uint64_t p) { return p <= wheel[size(wheel) - 1]; });	// and 2
+
+	const uint64_t odds = (n + 1) / 2;				// 1, 3, ..., up to n, odd number 2i + 1 has index i
+	const uint64_t segments = (odds + sieve_segment - 1) / sieve_segment;
+	const uint64_t blocks = (segments + sieve_block - 1) / sieve_block;
+	vector<uint64_t> counts(blocks);
+	parallel_for(static_cast<int>(blocks), [&](const int b) {
+		vector<uint8_t> sieve(sieve_segment);
+		vector<uint64_t> next(base.size());			// index of the next odd multiple to cross out
+		const uint64_t first = static_cast<uint64_t>(b) * sieve_block * sieve_segment;
+		for (size_t j = 0; j < base.size(); ++j) {
+			const uint64_t p = base[j];
+			const uint64_t start = p*p / 2;
+			next[j] = first <= start ? start : first + (p - (first - p/2) % p) % p;
+		}
+		uint64_t count = 0;
+		for (uint64_t low = first; low < min(odds, first + sieve_block*sieve_segment); low += sieve_segment) {
+			const uint64_t high = min(odds, low + sieve_segment);
+			const auto start = pattern.begin() + static_cast<ptrdiff_t>(low % period);
+			copy(start, start + sieve_segment, sieve.begin());
+			if (low == 0)							// the wheel's primes are not their own multiples
+				for (const uint64_t p : wheel)
+					sieve[p/2] = 0;
+			for (size_t j = 0; j < base.size(); ++j) {
+				uint64_t k = next[j];
+				for (; k < high; k += base[j])
+					sieve[k - low] = 1;
+				next[j] = k;
+			}
+			for (uint64_t i = low; i < high; ++i)
+				count += sieve[i - low] == 0;
+		}
+		counts[b] = count;
+	});
+
+	uint64_t count = 0;								// 2 is counted in place of 1
+	for (const uint64_t c : counts)
+		count += c;
+	return count;
+}
+
+// value of the number theory function k for the integer n
+uint64_t number_theory(const char k, const uint64_t n) {
+	switch (k) {
+		case t_isprime:
+			return is_prime(n);
+		case t_nextprime:
+			return next_prime(n);
+		case t_primepi:
+			return prime_pi(n);
+		case t_factor:
+			if (n == 0)
+				throw runtime_error(factorkey + ": argument must be positive");
+			return n == 1 ? 1 : prime_factors(n).front();
+		default:
+			throw runtime_error("function not implemented");
+	}
+}
+
+// n as a product of prime powers, for the note of factor()
+string factorization(const uint64_t n) {
+	ostringstream os;
+	os << factorkey << ": " << n << " =";
+	if (n == 1)
+		os << " 1";
+	const vector<uint64_t> factors = prime_factors(n);
+	for (size_t i = 0; i < factors.size(); ) {
+		size_t j = i;
+		while (j < factors.size() && factors[j] == factors[i])
+			++j;
+		os << (i == 0 ? " " : " * ") << factors[i];
+		if (j - i > 1)
+			os << '^' << j - i;
+		i = j;
+	}
+	return os.str();
+}
+
+// the integer held in the double x, the argument of number theory function k
+uint64_t natural(const char k, const double x) {
+	if (!isfinite(x) || x != trunc(x) || x < 0 || x > 0x1p53)
+		throw runtime_error(function_key(k) + ": integer from 0 to 2^53 expected, " + modekey + " " + integerkey
+			+ " takes larger ones");
+	return static_cast<uint64_t>(x);
+}
+
+// a number theory function of an integer held in a double, exact up to 2^53
+double number_theory(const char k, const double x) {
+	const uint64_t r = number_theory(k, natural(k, x));
+	if (r > uint64_t{1} << 53)
+		throw runtime_error(function_key(k) + ": result above 2^53, " + modekey + " " + integerkey
+			+ " gives it exactly");
+	return static_cast<double>(r);
+}
+
+// a step function, with derivative zero
+Dual number_theory(const char k, const Dual& x) {
+	return Dual{number_theory(k, x.v)};
+}
+
+// C(n, r) in 64 bits by the multiplicative formula, where every step C(n-r+i, i) =
+// C(n-r+i-1, i-1) * (n-r+i) / i is an exact division; false if it does not fit
+bool small_binomial(const uint64_t n, uint64_t r, uint64_t& c) {
+	c = r <= n;										// no ways to choose more than n
+	r = min(r, n - r);
+	for (uint64_t i = 1; c != 0 && i <= r; ++i) {
+		const uint128 t = static_cast<uint128>(c) * (n - r + i) / i;
+		if (t >> 64 != 0)
+			return false;
+		c = static_cast<uint64_t>(t);
+	}
+	return true;
+}
+
+// combinatorics function k of the arguments a in 64 bits; false if the result does not fit
+bool small_combinations(const char k, const vector<uint64_t>& a, uint64_t& c) {
+	switch (k) {
+		case t_ncr:
+			return small_binomial(a[0], a[1], c);
+		case t_npr:									// n (n-1) ... (n-r+1)
+			c = a[1] <= a[0];
+			for (uint64_t i = 0; c != 0 && i < a[1]; ++i)
+				if (__builtin_mul_overflow(c, a[0] - i, &c))
+					return false;
+			return true;
+		case t_multinomial:							// C(k1, k1) C(k1+k2, k2) C(k1+k2+k3, k3) ...
+		{
+			c = 1;
+			uint64_t n = 0;
+			for (const uint64_t x : a) {
+				uint64_t b;
+				if (__builtin_add_overflow(n, x, &n) || !small_binomial(n, x, b) || __builtin_mul_overflow(c, b, &c))
+					return false;
+			}
+			return true;
+		}
+		default:
+			throw runtime_error("function not implemented");
+	}
+}
+
+// combinatorics function k of the arguments a in double; exact while the result fits in
+// 64 bits, beyond that by the multiplicative formulas in floating point, whose relative
+// error is a few units in the last place per factor, and which reach infinity within a
+// thousand or so factors
+double combinations(const char k, const vector<uint64_t>& a) {
+	if (uint64_t c; small_combinations(k, a, c))
+		return static_cast<double>(c);
+
+	const auto binomial = [](const uint64_t n, uint64_t r) {
+		r = min(r, n - r);
+		double c = 1;
+		for (uint64_t i = 1; i <= r && isfinite(c); ++i)
+			c *= static_cast<double>(n - r + i) / static_cast<double>(i);	// no overflow short of the result
+		return c;
+	};
+	double c = 1;
+	switch (k) {
+		case t_ncr:
+			c = binomial(a[0], a[1]);
+			break;
+		case t_npr:
+			for (uint64_t i = 0; i < a[1] && isfinite(c); ++i)
+				c *= static_cast<double>(a[0] - i);
+			break;
+		case t_multinomial:
+		{
+			uint64_t n = 0;
+			for (const uint64_t x : a)
+				if (__builtin_add_overflow(n, x, &n))
+					c = numeric_limits<double>::infinity();
+				else
+					c *= binomial(n, x);
+			break;
+		}
+		default:
+			throw runtime_error("function not implemented");
+	}
+	if (!isfinite(c))
+		throw runtime_error(function_key(k) + ": result too large");
+	return c;
+}
+
+// combinatorics function k of integers held in doubles
+double combinations(const char k, const vector<double>& a) {
+	vector<uint64_t> n;
+	for (const double x : a)
+		n.push_back(natural(k, x));
+	return combinations(k, n);
+}
+
+// exponent of the prime p in n!, by Legendre's formula
+uint64_t factorial_exponent(uint64_t n, const uint64_t p) {
+	uint64_t e = 0;
+	while (n != 0) {
+		n /= p;
+		e += n;
+	}
+	return e;
+}
+
+// the product of the integers from a to b, in word sized chunks by a product tree
+Bigint range_product(const uint64_t a, const uint64_t b) {
+	vector<Bigint> chunks;
+	uint64_t chunk = 1;
+	for (uint64_t i = a; i <= b; ++i) {
+		if (uint64_t next; __builtin_mul_overflow(chunk, i, &next)) {
+			chunks.push_back(Bigint::from_unsigned(chunk));
+			chunk = i;
+		}
+		else
+			chunk = next;
+		if (i == b)									// as ++i would wrap for b = 2^64 - 1
+			break;
+	}
+	chunks.push_back(Bigint::from_unsigned(chunk));
+	return product(chunks);
+}
+
+// (k1 + ... + km)! / (k1! ... km!) exactly. When the arguments besides the largest sum to
+// little, or the sum is too large to sieve, it is the product of the integers above the
+// largest divided by their factorials, otherwise the product of the prime powers p^e of
+// its factorization, where e follows from Legendre's formula for the factorials; f is
+// the function to report errors for
+Bigint exact_multinomial(const vector<uint64_t>& k, const char f) {
+	uint64_t n = 0;
+	for (const uint64_t x : k)
+		if (__builtin_add_overflow(n, x, &n))
+			throw runtime_error(function_key(f) + ": arguments must sum to below 2^64");
+	const auto largest = ranges::max_element(k);
+	if (n - *largest <= combinatorics_direct || n > max_combinatorics) {
+		if (n - *largest > max_combinatorics)
+			throw runtime_error(function_key(f) + ": arguments too large, "
+				+ to_string(max_combinatorics) + " items besides the largest group at most");
+		vector<Bigint> factorials;
+		for (auto x = k.begin(); x != k.end(); ++x)
+			if (x != largest)
+				factorials.push_back(exact_factorial(static_cast<uint32_t>(*x)));
+		return range_product(*largest + 1, n) / product(factorials);
+	}
+
+	vector<Bigint> chunks;
+	uint64_t chunk = 1;
+	uint64_t twos = 0;
+	for (const uint64_t p : primes_up_to(n)) {
+		uint64_t e = factorial_exponent(n, p);
+		for (const uint64_t x : k)
+			e -= factorial_exponent(x, p);
+		if (p == 2) {								// added back by one shift
+			twos = e;
+			continue;
+		}
+		for (; e != 0; --e)
+			if (uint64_t next; __builtin_mul_overflow(chunk, p, &next)) {
+				chunks.push_back(Bigint::from_unsigned(chunk));
+				chunk = p;
+			}
+			else
+				chunk = next;
+	}
+	chunks.push_back(Bigint::from_unsigned(chunk));
+	return product(chunks).shifted(static_cast<int>(twos));
+}
+
+// combinatorics function k of the arguments a exactly
+Bigint exact_combinations(const char k, const vector<uint64_t>& a) {
+	if (uint64_t c; small_combinations(k, a, c))
+		return Bigint::from_unsigned(c);
+	switch (k) {
+		case t_ncr:
+			return exact_multinomial({a[1], a[0] - a[1]}, k);	// r <= n, or it would be 0
+		case t_npr:
+			if (a[1] > max_combinatorics)
+				throw runtime_error(nprkey + ": arguments too large, " + to_string(max_combinatorics)
+					+ " items at most");
+			return range_product(a[0] - a[1] + 1, a[0]);
+		case t_multinomial:
+			return exact_multinomial(a, k);
+		default:
+			throw runtime_error("function not implemented");
+	}
+}
+
+// the residue of n
+Modular Modular::from_bigint(const Bigint& n) {
+	Bigint r = n % Bigint::from_unsigned(modular_modulus);
+	if (r.negative)
+		r = r + Bigint::from_unsigned(modular_modulus);
+	return Modular{to_uint64(r.mag)};
+}
+
+// the residue of d, which must be an integer
+Modular Modular::from_double(const double d) {
+	if (!isfinite(d) || d != trunc(d))
+		throw runtime_error(modularkey + ": integer expected");
+	return from_bigint(Bigint::from_double(d));
+}
+
+Modular operator-(const Modular a) {
+	return Modular{a.v == 0 ? 0 : modular_modulus - a.v};
+}
+
+Modular operator+(const Modular a, const Modular b) {
+	const uint64_t s = a.v + b.v;					// no overflow, as the modulus is below 2^63
+	return Modular{s >= modular_modulus ? s - modular_modulus : s};
+}
+
+Modular operator-(const Modular a, const Modular b) {
+	return Modular{a.v >= b.v ? a.v - b.v : a.v + (modular_modulus - b.v)};
+}
+
+Modular operator*(const Modular a, const Modular b) {
+	return Modular{static_cast<uint64_t>(static_cast<uint128>(a.v) * b.v % modular_modulus)};
+}
+
+// a^-1 by the extended Euclidean algorithm, a must be coprime to the modulus
+Modular inverse(const Modular a) {
+	int128 r0 = modular_modulus, r1 = a.v;					// r = s*a mod modulus throughout
+	int128 s0 = 0, s1 = 1;
+	while (r1 != 0) {
+		const int128 q = r0 / r1;
+		r0 = exchange(r1, r0 - q*r1);
+		s0 = exchange(s1, s0 - q*s1);
+	}
+	if (r0 != 1)
+		throw runtime_error(modularkey + ": " + to_string(a.v) + " has no inverse modulo " + to_string(modular_modulus));
+	return Modular{static_cast<uint64_t>(s0 < 0 ? s0 + modular_modulus : s0)};
+}
+
+// b must not be zero
+Modular operator/(const Modular a, const Modular b) {
+	return a * inverse(b);
+}
+
+ostream& operator<<(ostream& os, const Modular x) {
+	return os << x.v;
+}
+
+// read the parenthesized, ',' separated arguments of function fname, at least min_n and at most max_n
+vector<Expr> arguments(Token_stream& ts, const string& fname, const int min_n, const int max_n) {
+	if (const Token t = ts.get(); t.kind != '(')
+		throw runtime_error(fname + ": primary expected");
+
+	vector<Expr> args;
+	if (const Token t = ts.get(); t.kind == ')' && min_n == 0)
+		return args;
+	else
+		ts.putback(t);
+	while (true) {
+		args.push_back(conditional_expression(ts));
+		const int n = static_cast<int>(args.size());
+		const Token t = ts.get();
+		if (t.kind == ',' && n < max_n)
+			continue;
+		if (t.kind == ')' && n >= min_n && n <= max_n)
+			return args;
+		throw runtime_error(fname + (n < min_n ? ": ',' expected" : ": ')' expected"));
+	}
+}
+
+// read the parenthesized, ',' separated n arguments of function fname
+vector<Expr> arguments(Token_stream& ts, const string& fname, const int n) {
+	return arguments(ts, fname, n, n);
+}
+
+// whether constants may be folded through evaluate(), which computes in double; the other
+// modes would then see rounded values, such as 1/3 as 3333333333333333/10000000000000000
+bool folds_constants() {
+	return mode == Mode::floating || mode == Mode::mixed;
+}
+
+// is e a number whose value is exact in the current mode? literals are read from their text in
+// the other modes, so only the numbers that deriv makes are exact there
+bool is_constant(const Expr& e) {
+	return e.kind == t_number && (folds_constants() || e.name.empty());
+}
+
+bool is_number(const Expr& e, const double d) {
+	return is_constant(e) && e.value == d;
+}
+
+// does e contain the variable named var?
+bool depends_on(const Expr& e, const string& var) {
+	if (e.kind == t_name)
+		return e.name == var;
+	return ranges::any_of(e.args, [&var](const Expr& a) { return depends_on(a, var); });
+}
+
+// simplify if(c, a, b) to a or b where c is constant; a branch whose constants cannot be
+// folded is left as it is, so that its error only shows if it is taken
+Expr simplify_if(const Expr& e) {
+	const Expr c = simplify(e.args[0]);
+	vector<Expr> a{c};
+	for (size_t i = 1; i < e.args.size(); ++i) {
+		if (is_constant(c) && (c.value != 0) != (i == 1))
+			continue;
+		try {
+			a.push_back(simplify(e.args[i]));
+		}
+		catch (runtime_error&) {
+			a.push_back(e.args[i]);
+		}
+	}
+	if (is_constant(c))
+		return a[1];
+	return Expr{t_if, a};
+}
+
+// fold constants and remove operations with no effect, such as 'x*1' and 'x+0'; constants are
+// only folded where the double evaluator is used, see folds_constants()
+Expr simplify(const Expr& e) {
+	if (e.args.empty())
+		return e;
+	if (e.kind == t_if)
+		return simplify_if(e);
+
+	vector<Expr> a;
+	for (const Expr& arg : e.args)
+		a.push_back(simplify(arg));
+	const Builtin* b = builtin(e.kind);
+	if (folds_constants() && (!b || b->pure) && ranges::all_of(a, [](const Expr& x) { return x.kind == t_number; }))
+		return Expr{t_number, evaluate(Expr{e.kind, a})};
+
+	switch (e.kind) {
+		case '+':
+			if (is_number(a[0], 0))
+				return a[1];
+			if (is_number(a[1], 0))
+				return a[0];
+			break;
+		case '-':
+			if (a.size() == 1) {
+				if (a[0].kind == '-' && a[0].args.size() == 1)
+					return a[0].args[0];				// -(-x) is x
+				break;
+			}
+			if (is_number(a[1], 0))
+				return a[0];
+			if (is_number(a[0], 0))
+				return Expr{'-', {a[1]}};
+			break;
+		case '*':
+			if (is_number(a[0], 0) || is_number(a[1], 0))
+				return Expr{t_number, 0.0};
+			if (is_number(a[0], 1))
+				return a[1];
+			if (is_number(a[1], 1))
+				return a[0];
+			if (is_number(a[0], -1))
+				return simplify(Expr{'-', {a[1]}});
+			break;
+		case '/':
+			if (is_number(a[1], 1))
+				return a[0];
+			if (is_number(a[0], 0))
+				return Expr{t_number, 0.0};
+			break;
+		case t_pow:
+			if (is_number(a[1], 1))
+				return a[0];
+			if (is_number(a[1], 0))
+				return Expr{t_number, 1.0};
+			break;
+		default:
+			break;
+	}
+	return Expr{e.kind, a};
+}
+
+// are a and b the same expression?
+bool same(const Expr& a, const Expr& b) {
+	if (a.kind != b.kind || a.args.size() != b.args.size())
+		return false;
+	if (a.kind == t_number)
+		return a.value == b.value;
+	if (a.kind == t_name)
+		return a.name == b.name;
+	for (size_t i = 0; i < a.args.size(); ++i)
+		if (!same(a.args[i], b.args[i]))
+			return false;
+	return true;
+}
+
+// a product coefficient * f1^n1 * f2^n2 * ..., for collecting like terms
+struct Monomial {
+	double coefficient = 1;
+	vector<pair<Expr, int>> factors;				// each factor with its power, at least 1
+};
+
+Expr collect(const Expr&);
+
+// multiply m by f^n
+void add_power(Monomial& m, const Expr& f, const int n) {
+	for (auto&[base, power] : m.factors)
+		if (same(base, f)) {
+			power += n;
+			return;
+		}
+	m.factors.emplace_back(f, n);
+}
+
+// multiply m by e, flattening products so that constant factors and powers of the same base meet
+void add_factor(Monomial& m, const Expr& e) {
+	constexpr double max_power = 1024;
+	switch (e.kind) {
+		case t_number:
+			m.coefficient *= e.value;
+			return;
+		case '*':
+			add_factor(m, e.args[0]);
+			add_factor(m, e.args[1]);
+			return;
+		case '-':
+			if (e.args.size() == 1) {
+				m.coefficient = -m.coefficient;
+				add_factor(m, e.args[0]);
+				return;
+			}
+			[[fallthrough]];
+		case '+':
+			if (const Expr c = collect(e); c.kind != '+' && (c.kind != '-' || c.args.size() == 1))
+				add_factor(m, c);
+			else
+				add_power(m, c, 1);
+			return;
+		case t_pow:									// only positive integer powers, so that no domain changes
+		{
+			const Expr& n = e.args[1];
+			if (n.kind == t_number && n.value >= 1 && n.value <= max_power && n.value == trunc(n.value)) {
+				add_power(m, collect(e.args[0]), static_cast<int>(n.value));
+				return;
+			}
+			break;
+		}
+		default:
+			break;
+	}
+	add_power(m, collect(e), 1);
+}
+
+// do a and b have the same factors to the same powers, in any order?
+bool like_terms(const Monomial& a, const Monomial& b) {
+	return a.factors.size() == b.factors.size() && ranges::all_of(a.factors, [&b](const auto& f) {
+		return ranges::any_of(b.factors, [&f](const auto& g) { return g.second == f.second && same(g.first, f.first); });
+	});
+}
+
+// add sign * e to the terms of a sum, flattening sums and differences
+void add_term(vector<Monomial>& terms, double& constant, const Expr& e, const double sign) {
+	if (e.kind == '+' || (e.kind == '-' && e.args.size() == 2)) {
+		add_term(terms, constant, e.args[0], sign);
+		add_term(terms, constant, e.args[1], e.kind == '+' ? sign : -sign);
+		return;
+	}
+	if (e.kind == '-') {
+		add_term(terms, constant, e.args[0], -sign);
+		return;
+	}
+	Monomial m;
+	add_factor(m, e);
+	m.coefficient *= sign;
+	if (m.factors.empty()) {
+		constant += m.coefficient;
+		return;
+	}
+	for (Monomial& t : terms)
+		if (like_terms(t, m)) {
+			t.coefficient += m.coefficient;
+			return;
+		}
+	terms.push_back(std::move(m));
+}
+
+// c times the factors of m
+Expr product(const Monomial& m, const double c) {
+	Expr p;
+	if (m.factors.empty() || abs(c) != 1)
+		p = Expr{t_number, c};
+	for (const auto&[base, power] : m.factors) {
+		const Expr f = power == 1 ? base : Expr{t_pow, {base, Expr{t_number, static_cast<double>(power)}}};
+		p = p.kind == 0 ? f : Expr{'*', {p, f}};
+	}
+	return c == -1 && !m.factors.empty() ? Expr{'-', {p}} : p;
+}
+
+// collect like terms and constant factors in the sums and products of e, e.g. x*2*x + x*x
+// is 3*pow(x, 2); this reassociates, so it is kept to expressions made by deriv
+Expr collect(const Expr& e) {
+	if (e.kind != '+' && e.kind != '-' && e.kind != '*') {
+		vector<Expr> a;
+		for (const Expr& arg : e.args)
+			a.push_back(collect(arg));
+		Expr c = e;
+		c.args = std::move(a);
+		return c;
+	}
+
+	vector<Monomial> terms;
+	double constant = 0;
+	add_term(terms, constant, e, 1);
+	if (constant != 0)
+		terms.push_back(Monomial{constant, {}});
+
+	Expr s;
+	for (const Monomial& m : terms) {
+		if (m.coefficient == 0)
+			continue;
+		if (s.kind == 0)
+			s = product(m, m.coefficient);
+		else
+			s = Expr{m.coefficient < 0 ? '-' : '+', {s, product(m, abs(m.coefficient))}};
+	}
+	return s.kind != 0 ? s : Expr{t_number, 0.0};
+}
+
+// return the (unsimplified) derivative of e with respect to var
+Expr derivative(const Expr& e, const string& var) {
+	switch (e.kind) {
+		case t_number:
+			return Expr{t_number, 0.0};
+		case t_name:
+			return Expr{t_number, e.name == var ? 1.0 : 0.0};
+		case '+':
+			return Expr{'+', {derivative(e.args[0], var), derivative(e.args[1], var)}};
+		case '-':
+			if (e.args.size() == 1)
+				return Expr{'-', {derivative(e.args[0], var)}};
+			return Expr{'-', {derivative(e.args[0], var), derivative(e.args[1], var)}};
+		case '*':									// u'v + uv'
+		{
+			const Expr& u = e.args[0];
+			const Expr& v = e.args[1];
+			return Expr{'+', {Expr{'*', {derivative(u, var), v}}, Expr{'*', {u, derivative(v, var)}}}};
+		}
+		case '/':									// (u'v - uv') / v*v
+		{
+			const Expr& u = e.args[0];
+			const Expr& v = e.args[1];
+			const Expr top{'-', {Expr{'*', {derivative(u, var), v}}, Expr{'*', {u, derivative(v, var)}}}};
+			return Expr{'/', {top, Expr{'*', {v, v}}}};
+		}
+		case '<':									// constant where they are defined
+		case t_less_equal:
+		case '>':
+		case t_greater_equal:
+		case t_equal:
+		case t_not_equal:
+			return Expr{t_number, 0.0};
+		case '%':									// u' while the divisor is constant
+			if (!depends_on(e.args[1], var))
+				return derivative(e.args[0], var);
+			[[fallthrough]];
+		case '!':
+			if (!depends_on(e, var))
+				return Expr{t_number, 0.0};
+			throw runtime_error(string{"deriv: cannot differentiate '"} + e.kind + "'");
+		default:
+		{
+			const Builtin* b = builtin(e.kind);
+			if (!b)
+				throw runtime_error("deriv: unknown operation");
+			if (b->derivative)
+				return b->derivative(e, var);
+			if (!depends_on(e, var))
+				return Expr{t_number, 0.0};
+			throw runtime_error("deriv: cannot differentiate " + function_key(e.kind));
+		}
+	}
+}
+
+// parse a call to the function named by t, with the arguments its builtin entry allows
+Expr function_call(Token_stream& ts, const Token& t) {
+	const Builtin& b = *builtin(t.kind);
+	vector<Expr> args = arguments(ts, b.name, b.min_args, b.max_args);
+	switch (t.kind) {
+		case t_deriv:
+			if (args[1].kind != t_name)
+				throw runtime_error("deriv: name expected");
+		{
+			const Expr d = simplify(derivative(args[0], args[1].name));
+			return folds_constants() ? collect(d) : d;	// collecting multiplies coefficients in double
+		}
+		case t_interp:
+			if (args[0].kind != t_name)
+				throw runtime_error(interpkey + ": " + tablekey + " name expected");
+			symbols.get_table(args[0].name);		// so that an error shows where the formula is written
+			break;
+		case t_solve:
+		case t_integrate:
+			if (args[1].kind != t_name)
+				throw runtime_error(b.name + ": name expected");
+			break;
+		case t_minimize:							// a start value for each name
+			if (args.size() % 2 == 0)
+				throw runtime_error("minimize: a start value is needed for each name");
+			for (size_t i = 1; i <= args.size() / 2; ++i)
+				if (args[i].kind != t_name)
+					throw runtime_error("minimize: name expected");
+			break;
+		case t_odesolve:							// n right-hand sides, t, n names, t0, n start values, t1
+		{
+			if (args.size() % 3 != 0)
+				throw runtime_error("odesolve: a name and a start value is needed for each right-hand side");
+			const size_t n = args.size()/3 - 1;
+			for (size_t i = n; i <= 2*n; ++i)
+				if (args[i].kind != t_name)
+					throw runtime_error("odesolve: name expected");
+			break;
+		}
+		default:
+			break;
+	}
+	return Expr{t.kind, std::move(args)};
+}
+
+// deal with numbers, signage, names, functions, assignment, and parentheses/braces
+Expr primary(Token_stream& ts) {
+	switch (Token t = ts.get(); t.kind) {
+		case '(':
+		{
+			Expr e = conditional_expression(ts);
+			t = ts.get();
+			if (t.kind != ')')
+				throw runtime_error("')' expected");
+			return e;
+		}
+		case '{':
+		{
+			Expr e = conditional_expression(ts);
+			t = ts.get();
+			if (t.kind != '}')
+				throw runtime_error("'}' expected");
+			return e;
+		}
+		case t_number:
+		{
+			Expr e{t_number, t.value};
+			e.name = t.name;
+			return e;
+		}
+		case '-':
+			return Expr{'-', {primary(ts)}};
+		case '+':
+			return primary(ts);
+		case t_name: {
+			if (const Formula* f = symbols.get_formula(t.name))
+				return f->source;					// use the formula's body in place of its name
+			return Expr{t_name, t.name};
+		}
+		default:
+			if (builtin(t.kind))
+				return function_call(ts, t);
+			throw runtime_error("primary expected");
+	}
+}
+
+// deal with factorials, '!'
+Expr secondary(Token_stream& ts) {
+	Expr left = primary(ts);
+	Token t = ts.get();
+	while (true) {
+		switch (t.kind) {
+			case '!':
+				left = Expr{'!', {left}};
+				t = ts.get();
+				break;
+			default:
+				ts.putback(t);
+				return left;
+		}
+	}
+}
+
+// deal with '*', '/', and '%'
+Expr term(Token_stream& ts) {
+	Expr left = secondary(ts);
+	Token t = ts.get();
+	while (true) {
+		switch (t.kind) {
+			case '*':
+			case '/':
+			case '%':
+				left = Expr{t.kind, {left, secondary(ts)}};
+				t = ts.get();
+				break;
+			default:
+				ts.putback(t);
+				return left;
+		}
+	}
+}
+
+// deal with '+' and '-'
+Expr expression(Token_stream& ts) {
+	Expr left = term(ts);
+	Token t = ts.get();
+	while (true) {
+		switch (t.kind) {
+			case '+':
+			case '-':
+				left = Expr{t.kind, {left, term(ts)}};
+				t = ts.get();
+				break;
+			default:
+				ts.putback(t);
+				return left;
+		}
+	}
+}
+
+// deal with '<', '<=', '>', '>=', '==' and '!=', which give 1 if they hold and otherwise 0
+Expr comparison(Token_stream& ts) {
+	Expr left = expression(ts);
+	Token t = ts.get();
+	while (true) {
+		switch (t.kind) {
+			case '<':
+			case t_less_equal:
+			case '>':
+			case t_greater_equal:
+			case t_equal:
+			case t_not_equal:
+				left = Expr{t.kind, {left, expression(ts)}};
+				t = ts.get();
+				break;
+			default:
+				ts.putback(t);
+				return left;
+		}
+	}
+}
+
+// deal with 'c ? a : b', the same as if(c, a, b)
+Expr conditional_expression(Token_stream& ts) {
+	Expr c = comparison(ts);
+	const Token t = ts.get();
+	if (t.kind != '?') {
+		ts.putback(t);
+		return c;
+	}
+	Expr a = conditional_expression(ts);
+	if (const Token t2 = ts.get(); t2.kind != ':') {
+		ts.putback(t2);								// which may end the statement, for clean_up
+		throw runtime_error("':' expected");
+	}
+	return Expr{t_if, {std::move(c), std::move(a), conditional_expression(ts)}};
+}
+
+// root finding for solve(), f takes the variable solved for as its only parameter
+constexpr int max_iterations = 200;
+constexpr double root_tolerance = 1e-15;
+
+// Newton's method from x using f's derivative, false if it does not converge
+bool newton(const Program& f, double& x) {
+	try {
+		for (int i = 0; i < max_iterations; ++i) {
+			const Dual arg{x, 1};
+			const Dual y = f.run(&arg);
+			if (y.v == 0)
+				return true;
+			if (y.d == 0 || !isfinite(y.v) || !isfinite(y.d))
+				return false;
+
+			const double step = y.v / y.d;
+			x -= step;
+			if (!isfinite(x))
+				return false;
+			if (abs(step) <= 4*numeric_limits<double>::epsilon()*abs(x) + root_tolerance)
+				return true;
+		}
+	}
+	catch (runtime_error&) {						// stepped outside of f's domain
+	}
+	return false;
+}
+
+// Brent's method on [a, b], where f(a) and f(b) must have opposite signs
+double brent(const Program& f, double a, double b) {
+	double fa = f.run(&a);
+	double fb = f.run(&b);
+	if ((fa > 0 && fb > 0) || (fa < 0 && fb < 0))
+		throw runtime_error("solve: expression must have opposite signs at both ends");
+
+	double c = b;
+	double fc = fb;
+	double d = b - a;
+	double e = d;
+	for (int i = 0; i < max_iterations; ++i) {
+		if ((fb > 0 && fc > 0) || (fb < 0 && fc < 0)) {
+			c = a;									// keep the root between b and c
+			fc = fa;
+			d = e = b - a;
+		}
+		if (abs(fc) < abs(fb)) {					// b is the best guess so far
+			a = b; b = c; c = a;
+			fa = fb; fb = fc; fc = fa;
+		}
+
+		const double tol = 2*numeric_limits<double>::epsilon()*abs(b) + 0.5*root_tolerance;
+		const double m = 0.5*(c - b);
+		if (abs(m) <= tol || fb == 0)
+			return b;
+
+		if (abs(e) >= tol && abs(fa) > abs(fb)) {	// try inverse quadratic interpolation
+			const double s = fb / fa;
+			double p;
+			double q;
+			if (a == c) {
+				p = 2*m*s;
+				q = 1 - s;
+			}
+			else {
+				const double r = fb / fc;
+				q = fa / fc;
+				p = s*(2*m*q*(q - r) - (b - a)*(r - 1));
+				q = (q - 1)*(r - 1)*(s - 1);
+			}
+			if (p > 0)
+				q = -q;
+			else
+				p = -p;
+
+			if (2*p < min(3*m*q - abs(tol*q), abs(e*q))) {
+				e = d;
+				d = p / q;
+			}
+			else {									// interpolation too slow, bisect
+				d = m;
+				e = m;
+			}
+		}
+		else {
+			d = m;
+			e = m;
+		}
+		a = b;
+		fa = fb;
+		b += abs(d) > tol ? d : (m > 0 ? tol : -tol);
+		fb = f.run(&b);
+	}
+	throw runtime_error("solve: no convergence");
+}
+
+// search outward from x for an interval [a, b] over which f changes sign
+bool find_bracket(const Program& f, const double x, double& a, double& b) {
+	const auto value = [&f](const double t) {
+		try {
+			return f.run(&t);
+		}
+		catch (runtime_error&) {					// outside of f's domain
+			return numeric_limits<double>::quiet_NaN();
+		}
+	};
+
+	double lo = x;
+	double hi = x;
+	double flo = value(x);
+	double fhi = flo;
+	for (double h = max(abs(x), 1.0) / 64; isfinite(h); h *= 2) {
+		for (const double side : {-1.0, 1.0}) {
+			const double next = x + side*h;
+			const double fnext = value(next);
+			double& near = side < 0 ? lo : hi;
+			double& fnear = side < 0 ? flo : fhi;
+			if (isfinite(fnear) && isfinite(fnext) && (fnear <= 0) != (fnext <= 0)) {
+				a = min(near, next);
+				b = max(near, next);
+				return true;
+			}
+			near = next;
+			fnear = fnext;
+		}
+	}
+	return false;
+}
+
+// root of f near guess: Newton's method, falling back to Brent's method
+double find_root(const Program& f, double guess) {
+	if (double x = guess; newton(f, x))
+		return x;
+
+	double a;
+	double b;
+	if (!find_bracket(f, guess, a, b))
+		throw runtime_error("solve: no root found near guess");
+	return brent(f, a, b);
+}
+
+// root of f between lo and hi
+double find_root(const Program& f, const double lo, const double hi) {
+	return brent(f, lo, hi);
+}
+
+// adaptive Gauss-Kronrod quadrature for integrate(), f takes the variable of integration as its only parameter
+constexpr double integrate_tolerance = 1e-10;		// relative
+constexpr double integrate_floor = 1e-14;			// absolute, for integrals close to 0
+constexpr int max_intervals = 100000;
+constexpr double mixed_tolerance = 1e-5;			// relative, when the integrand is evaluated in single precision
+
+class Interval {
+public:
+	double a;
+	double b;
+	double value;									// integral over [a, b]
+	double error;									// estimated absolute error of value
+	double rounding;								// of that, from evaluating f in single precision
+};
+
+// 15 point Kronrod rule over [a, b], with the embedded 7 point Gauss rule for its error estimate
+Interval gauss_kronrod(const Program& f, const double a, const double b) {
+	static constexpr double xk[8] = {
+		0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+		0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+		0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+		0.207784955007898467600689403773245, 0.0};
+	static constexpr double wk[8] = {
+		0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+		0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+		0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+		0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+	static constexpr double wg[4] = {						// Gauss weights for xk[1], xk[3], xk[5], xk[7]
+		0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+		0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+	const bool single = mode == Mode::mixed;
+	const auto sample = [&f, single](const double x) {
+		const float xs = static_cast<float>(x);
+		return single ? static_cast<double>(f.run(&xs)) : f.run(&x);
+	};
+	const double center = (a + b) / 2;
+	const double half = (b - a) / 2;
+	double fx[15];
+	for (int j = 0; j < 7; ++j) {
+		fx[2*j] = sample(center - half*xk[j]);
+		fx[2*j+1] = sample(center + half*xk[j]);
+	}
+	fx[14] = sample(center);
+
+	double kronrod = wk[7]*fx[14];
+	double gauss = wg[3]*fx[14];
+	for (int j = 0; j < 7; ++j) {
+		kronrod += wk[j]*(fx[2*j] + fx[2*j+1]);
+		if (j % 2 == 1)
+			gauss += wg[j/2]*(fx[2*j] + fx[2*j+1]);
+	}
+
+	// scale |kronrod - gauss| as QUADPACK does, it overestimates the error of the Kronrod rule
+	const double mean = kronrod / 2;
+	double spread = wk[7]*abs(fx[14] - mean);
+	for (int j = 0; j < 7; ++j)
+		spread += wk[j]*(abs(fx[2*j] - mean) + abs(fx[2*j+1] - mean));
+	spread *= abs(half);
+	double error = abs((kronrod - gauss)*half);
+	if (spread != 0 && error != 0)
+		error = spread * min(1.0, pow(200*error/spread, 1.5));
+
+	// in mixed mode, the center's error in single precision stands for the other points'
+	const double rounding = single ? abs((fx[14] - f.run(&center))*(b - a)) : 0;
+	return Interval{a, b, kronrod*half, max(error, rounding), rounding};
+}
+
+// integral of f over [a, b], bisecting every interval with too large an error share in parallel
+double integrate(const Program& f, const double a, const double b) {
+	const double relative = mode == Mode::mixed ? mixed_tolerance : integrate_tolerance;
+	vector<Interval> parts{gauss_kronrod(f, a, b)};
+	double value = parts[0].value;
+	double error = parts[0].error;
+	double rounding = parts[0].rounding;
+	while (true) {
+		const double tolerance = max(relative*abs(value), integrate_floor);
+		if (error <= tolerance || !isfinite(error) || parts.size() >= max_intervals)
+			break;
+
+		const double share = tolerance / static_cast<double>(parts.size());
+		vector<Interval> keep;
+		vector<Interval> split;
+		for (const Interval& p : parts)
+			(p.error > share ? split : keep).push_back(p);
+
+		vector<Interval> halves(2*split.size());
+		parallel_for(static_cast<int>(halves.size()), [&](const int i) {
+			const Interval& p = split[i/2];
+			const double mid = (p.a + p.b) / 2;
+			halves[i] = i % 2 == 0 ? gauss_kronrod(f, p.a, mid) : gauss_kronrod(f, mid, p.b);
+		}, 64);
+
+		parts = std::move(keep);
+		parts.insert(parts.end(), halves.begin(), halves.end());
+		value = 0;
+		error = 0;
+		rounding = 0;
+		for (const Interval& p : parts) {
+			value += p.value;
+			error += p.error;
+			rounding += p.rounding;
+		}
+	}
+
+	ostringstream os;
+	os << "integrate: error estimate " << error << ", " << 15*(2*parts.size() - 1) << " evaluations";
+	if (mode == Mode::mixed)
+		os << " in single precision, rounding error estimate " << rounding;
+	if (error > max(relative*abs(value), integrate_floor))
+		os << ", tolerance not reached";
+	note = os.str();
+	return value;
+}
+
+// minimization for minimize(), f takes the variables minimized over as its parameters
+constexpr int max_minimize_iterations = 10000;
+constexpr int lbfgs_history = 8;					// number of steps L-BFGS remembers
+constexpr double minimize_tolerance = 1e-10;
+
+double dot(const vector<double>& a, const vector<double>& b) {
+	double sum = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+		sum += a[i]*b[i];
+	return sum;
+}
+
+// value of f at x, and its gradient in g by one forward mode pass per variable
+double gradient(const Program& f, const vector<double>& x, vector<double>& g) {
+	vector<Dual> args(x.begin(), x.end());
+	double value = 0;
+	for (size_t i = 0; i < x.size(); ++i) {
+		args[i].d = 1;
+		const Dual y = f.run(args.data());
+		args[i].d = 0;
+		value = y.v;
+		g[i] = y.d;
+	}
+	return value;
+}
+
+// limited memory BFGS with a backtracking line search, false if it does not converge
+bool lbfgs(const Program& f, vector<double>& x, double& fx, int& iterations) {
+	const size_t n = x.size();
+	vector<double> g(n);
+	vector<vector<double>> s;						// last steps taken, oldest first
+	vector<vector<double>> y;						// and the gradient changes they caused
+	try {
+		fx = gradient(f, x, g);
+	}
+	catch (runtime_error&) {						// start is outside of f's domain
+		return false;
+	}
+
+	for (iterations = 0; iterations < max_minimize_iterations; ++iterations) {
+		if (!isfinite(fx) || ranges::any_of(g, [](const double d) { return !isfinite(d); }))
+			return false;
+		if (ranges::all_of(g, [fx](const double d) { return abs(d) <= minimize_tolerance*max(1.0, abs(fx)); }))
+			return true;
+
+		// two loop recursion: d = -H*g, H approximating the inverse Hessian from the remembered steps
+		const int k = static_cast<int>(s.size());
+		vector<double> d = g;
+		vector<double> alpha(k);
+		for (int i = k-1; i >= 0; --i) {
+			alpha[i] = dot(s[i], d) / dot(y[i], s[i]);
+			for (size_t j = 0; j < n; ++j)
+				d[j] -= alpha[i]*y[i][j];
+		}
+		const double gamma = k > 0 ? dot(s[k-1], y[k-1]) / dot(y[k-1], y[k-1]) : 1 / max(1.0, sqrt(dot(g, g)));
+		for (double& dj : d)
+			dj *= gamma;
+		for (int i = 0; i < k; ++i) {
+			const double beta = dot(y[i], d) / dot(y[i], s[i]);
+			for (size_t j = 0; j < n; ++j)
+				d[j] += (alpha[i] - beta)*s[i][j];
+		}
+		for (double& dj : d)
+			dj = -dj;
+
+		double slope = dot(g, d);
+		if (slope >= 0) {							// not a descent direction, restart from steepest descent
+			s.clear();
+			y.clear();
+			for (size_t j = 0; j < n; ++j)
+				d[j] = -g[j];
+			slope = -dot(g, g);
+		}
+
+		// halve the step until it decreases f enough (Armijo condition)
+		vector<double> xn(n);
+		vector<double> gn(n);
+		double fn;
+		for (double step = 1; ; step /= 2) {
+			if (step < 1e-20)
+				return false;
+			for (size_t j = 0; j < n; ++j)
+				xn[j] = x[j] + step*d[j];
+			try {
+				fn = gradient(f, xn, gn);
+			}
+			catch (runtime_error&) {
+				continue;
+			}
+			if (isfinite(fn) && fn <= fx + 1e-4*step*slope)
+				break;
+		}
+
+		vector<double> sn(n);
+		vector<double> yn(n);
+		for (size_t j = 0; j < n; ++j) {
+			sn[j] = xn[j] - x[j];
+			yn[j] = gn[j] - g[j];
+		}
+		if (dot(sn, yn) > 0) {						// keep the inverse Hessian estimate positive definite
+			if (s.size() == lbfgs_history) {
+				s.erase(s.begin());
+				y.erase(y.begin());
+			}
+			s.push_back(std::move(sn));
+			y.push_back(std::move(yn));
+		}
+
+		const bool stalled = abs(fx - fn) <= numeric_limits<double>::epsilon()*max(1.0, abs(fn));
+		x = xn;
+		fx = fn;
+		g = gn;
+		if (stalled)
+			return true;
+	}
+	return false;
+}
+
+// Nelder-Mead simplex search from x, needing no derivatives
+void nelder_mead(const Program& f, vector<double>& x, double& fx, int& iterations) {
+	const auto value = [&f](const vector<double>& p) {
+		try {
+			const double v = f.run(p.data());
+			return isnan(v) ? numeric_limits<double>::infinity() : v;
+		}
+		catch (runtime_error&) {					// outside of f's domain
+			return numeric_limits<double>::infinity();
+		}
+	};
+
+	const size_t n = x.size();
+	vector<vector<double>> p(n+1, x);				// simplex of n+1 points, with a step along each axis
+	for (size_t i = 0; i < n; ++i)
+		p[i+1][i] += x[i] != 0 ? 0.05*x[i] : 0.00025;
+	vector<double> fp(n+1);
+	for (size_t i = 0; i <= n; ++i)
+		fp[i] = value(p[i]);
+
+	const auto point = [&](const vector<double>& centroid, const vector<double>& from, const double t) {
+		vector<double> r(n);
+		for (size_t j = 0; j < n; ++j)
+			r[j] = centroid[j] + t*(from[j] - centroid[j]);
+		return r;
+	};
+
+	for (iterations = 0; iterations < max_minimize_iterations; ++iterations) {
+		vector<size_t> order(n+1);					// best point first, worst last
+		for (size_t i = 0; i <= n; ++i)
+			order[i] = i;
+		ranges::sort(order, [&fp](const size_t a, const size_t b) { return fp[a] < fp[b]; });
+		vector<vector<double>> sorted_p;
+		vector<double> sorted_f;
+		for (const size_t i : order) {
+			sorted_p.push_back(p[i]);
+			sorted_f.push_back(fp[i]);
+		}
+		p = std::move(sorted_p);
+		fp = std::move(sorted_f);
+
+		double size = 0;
+		for (size_t i = 1; i <= n; ++i)
+			for (size_t j = 0; j < n; ++j)
+				size = max(size, abs(p[i][j] - p[0][j]));
+		if (abs(fp[n] - fp[0]) <= minimize_tolerance*max(1.0, abs(fp[0])) && size <= minimize_tolerance*max(1.0, abs(p[0][0])))
+			break;
+
+		vector<double> centroid(n, 0.0);			// of all points but the worst
+		for (size_t i = 0; i < n; ++i)
+			for (size_t j = 0; j < n; ++j)
+				centroid[j] += p[i][j] / static_cast<double>(n);
+
+		const vector<double> reflected = point(centroid, p[n], -1);
+		const double fr = value(reflected);
+		if (fr < fp[0]) {
+			const vector<double> expanded = point(centroid, p[n], -2);
+			const double fe = value(expanded);
+			p[n] = fe < fr ? expanded : reflected;
+			fp[n] = min(fe, fr);
+		}
+		else if (fr < fp[n-1]) {
+			p[n] = reflected;
+			fp[n] = fr;
+		}
+		else {
+			const vector<double> contracted = point(centroid, fr < fp[n] ? reflected : p[n], 0.5);
+			const double fc = value(contracted);
+			if (fc < min(fr, fp[n])) {
+				p[n] = contracted;
+				fp[n] = fc;
+			}
+			else {									// shrink towards the best point
+				for (size_t i = 1; i <= n; ++i) {
+					p[i] = point(p[0], p[i], 0.5);
+					fp[i] = value(p[i]);
+				}
+			}
+		}
+	}
+
+	const auto best = ranges::min_element(fp) - fp.begin();
+	x = p[best];
+	fx = fp[best];
+}
+
+// minimum of f starting from x: L-BFGS, falling back to Nelder-Mead
+double minimize(const Program& f, const vector<string>& names, vector<double> x) {
+	double fx = 0;
+	int iterations = 0;
+	string method = "L-BFGS";
+	if (!lbfgs(f, x, fx, iterations)) {
+		method = "Nelder-Mead";
+		nelder_mead(f, x, fx, iterations);
+	}
+
+	ostringstream os;
+	os << "minimize: " << method << " in " << iterations << " iterations, at ";
+	for (size_t i = 0; i < names.size(); ++i)
+		os << (i == 0 ? "" : ", ") << names[i] << " = " << x[i];
+	note = os.str();
+	return fx;
+}
+
+// ODE integration for odesolve(), each f[i] takes t and then the state variables as parameters
+constexpr double ode_rtol = 1e-8;
+constexpr double ode_atol = 1e-10;
+constexpr int max_ode_steps = 1000000;
+
+// derivatives f(t, y) of the state y
+vector<double> rates(const vector<Program>& f, const double t, const vector<double>& y) {
+	vector<double> args{t};
+	args.insert(args.end(), y.begin(), y.end());
+	vector<double> dy(f.size());
+	for (size_t i = 0; i < f.size(); ++i)
+		dy[i] = f[i].run(args.data());
+	return dy;
+}
+
+// Jacobian df/dy in jac and df/dt in ft, by forward mode passes along t and each y[j]
+void jacobian(const vector<Program>& f, const double t, const vector<double>& y,
+			vector<vector<double>>& jac, vector<double>& ft) {
+	const size_t n = y.size();
+	vector<Dual> args{Dual{t}};
+	args.insert(args.end(), y.begin(), y.end());
+	jac.assign(n, vector<double>(n));
+	ft.assign(n, 0);
+	for (size_t j = 0; j <= n; ++j) {				// j == 0 is t
+		args[j].d = 1;
+		for (size_t i = 0; i < n; ++i) {
+			const double d = f[i].run(args.data()).d;
+			if (j == 0)
+				ft[i] = d;
+			else
+				jac[i][j-1] = d;
+		}
+		args[j].d = 0;
+	}
+}
+
+// solve a*x = b by Gaussian elimination with partial pivoting, b is replaced by x
+void linear_solve(vector<vector<double>> a, vector<double>& b) {
+	const size_t n = b.size();
+	for (size_t c = 0; c < n; ++c) {
+		size_t p = c;
+		for (size_t r = c+1; r < n; ++r)
+			if (abs(a[r][c]) > abs(a[p][c]))
+				p = r;
+		if (a[p][c] == 0)
+			throw runtime_error("odesolve: singular system in implicit step");
+		swap(a[p], a[c]);
+		swap(b[p], b[c]);
+		for (size_t r = c+1; r < n; ++r) {
+			const double m = a[r][c] / a[c][c];
+			for (size_t k = c; k < n; ++k)
+				a[r][k] -= m*a[c][k];
+			b[r] -= m*b[c];
+		}
+	}
+	for (size_t c = n; c-- > 0; ) {
+		for (size_t k = c+1; k < n; ++k)
+			b[c] -= a[c][k]*b[k];
+		b[c] /= a[c][c];
+	}
+}
+
+// size of the error estimate err relative to the tolerances, a step is accepted if this is <= 1
+double error_ratio(const vector<double>& err, const vector<double>& y, const vector<double>& yn) {
+	double sum = 0;
+	for (size_t i = 0; i < err.size(); ++i) {
+		const double scale = ode_atol + ode_rtol*max(abs(y[i]), abs(yn[i]));
+		sum += (err[i]/scale)*(err[i]/scale);
+	}
+	return sqrt(sum / static_cast<double>(err.size()));
+}
+
+// factor to change the step size by, for an error estimate of the given order
+double step_factor(const double ratio, const int order) {
+	if (isnan(ratio))
+		return 0.2;
+	if (ratio == 0)
+		return 5;
+	return clamp(0.9*pow(ratio, -1.0/order), 0.2, 5.0);
+}
+
+// integrate y' = f(t, y) from t0 to t1 with Dormand-Prince RK45, switching to a
+// linearly implicit Rosenbrock method once the problem shows itself to be stiff
+vector<double> odesolve(const vector<Program>& f, double t, vector<double> y, const double t1,
+						int& rk_steps, int& implicit_steps) {
+	// Dormand-Prince coefficients, the last row of a is also the 5th order solution
+	static constexpr double c[7] = {0, 1.0/5, 3.0/10, 4.0/5, 8.0/9, 1, 1};
+	static constexpr double a[7][6] = {
+		{},
+		{1.0/5},
+		{3.0/40, 9.0/40},
+		{44.0/45, -56.0/15, 32.0/9},
+		{19372.0/6561, -25360.0/2187, 64448.0/6561, -212.0/729},
+		{9017.0/3168, -355.0/33, 46732.0/5247, 49.0/176, -5103.0/18656},
+		{35.0/384, 0, 500.0/1113, 125.0/192, -2187.0/6784, 11.0/84}};
+	static constexpr double e[7] = {							// 5th minus 4th order weights
+		71.0/57600, 0, -71.0/16695, 71.0/1920, -17253.0/339200, 22.0/525, -1.0/40};
+	static constexpr double ros_gamma = 1.0/2;
+	static constexpr double ros_ax[4] = {0, 1, 3.0/5, 3.0/5};
+	static constexpr double ros_a[3][2] = {{}, {2}, {48.0/25, 6.0/25}};
+	static constexpr double ros_c[4][3] = {{}, {-8}, {372.0/25, 12.0/5}, {-112.0/125, -54.0/125, -2.0/5}};
+	static constexpr double ros_cx[4] = {1.0/2, -3.0/2, 121.0/50, 29.0/250};
+	static constexpr double ros_b[4] = {19.0/9, 1.0/2, 25.0/108, 125.0/108};
+	static constexpr double ros_e[4] = {17.0/54, 7.0/36, 0, 125.0/108};
+
+	const size_t n = y.size();
+	const double direction = t1 >= t ? 1 : -1;
+	double h = direction*abs(t1 - t) / 100;
+	bool stiff = false;
+	int stiff_count = 0;							// consecutive steps that looked stiff
+	int nonstiff_count = 0;
+	rk_steps = 0;
+	implicit_steps = 0;
+
+	vector<vector<double>> k(7, vector<double>(n));
+	k[0] = rates(f, t, y);
+	while (direction*(t1 - t) > 0) {
+		if (rk_steps + implicit_steps >= max_ode_steps)
+			throw runtime_error("odesolve: too many steps");
+		if (abs(h) < 16*numeric_limits<double>::epsilon()*abs(t))
+			throw runtime_error("odesolve: step size too small");
+		if (direction*(t + h - t1) > 0)
+			h = t1 - t;
+
+		vector<double> yn(n);
+		vector<double> err(n);
+		double ratio;
+		if (!stiff) {
+			vector<double> stage(n);
+			for (int s = 1; s < 7; ++s) {
+				for (size_t i = 0; i < n; ++i) {
+					double sum = 0;
+					for (int j = 0; j < s; ++j)
+						sum += a[s][j]*k[j][i];
+					stage[i] = y[i] + h*sum;
+				}
+				k[s] = rates(f, t + c[s]*h, stage);
+			}
+			yn = stage;								// the 7th stage is evaluated at the solution
+			for (size_t i = 0; i < n; ++i) {
+				double sum = 0;
+				for (int j = 0; j < 7; ++j)
+					sum += e[j]*k[j][i];
+				err[i] = h*sum;
+			}
+			ratio = error_ratio(err, y, yn);
+			if (ratio <= 1) {
+				// estimate h*lambda from the last two stages, which are both at t+h
+				double num = 0;
+				double den = 0;
+				vector<double> y6(n);
+				for (size_t i = 0; i < n; ++i) {
+					double sum = 0;
+					for (int j = 0; j < 5; ++j)
+						sum += a[5][j]*k[j][i];
+					y6[i] = y[i] + h*sum;
+					num += (k[6][i] - k[5][i])*(k[6][i] - k[5][i]);
+					den += (yn[i] - y6[i])*(yn[i] - y6[i]);
+				}
+				if (den > 0 && abs(h)*sqrt(num/den) > 3.25) {
+					nonstiff_count = 0;
+					if (++stiff_count == 15)
+						stiff = true;
+				}
+				else if (++nonstiff_count == 6)
+					stiff_count = 0;
+				++rk_steps;
+				t += h;
+				y = yn;
+				k[0] = k[6];
+			}
+			h *= step_factor(ratio, 5);
+		}
+		else {
+			// 4th order Rosenbrock method of Kaps and Rentrop, with Shampine's coefficients;
+			// each stage solves (I/(gamma*h) - J)*g = f(...) + h*cx*ft + sum of earlier g/h
+			vector<vector<double>> jac;
+			vector<double> ft;
+			jacobian(f, t, y, jac, ft);
+			vector<vector<double>> m(n, vector<double>(n));
+			for (size_t i = 0; i < n; ++i)
+				for (size_t j = 0; j < n; ++j)
+					m[i][j] = (i == j ? 1/(ros_gamma*h) : 0) - jac[i][j];
+
+			vector<vector<double>> g(4, vector<double>(n));
+			vector<double> dy = k[0];
+			for (int s = 0; s < 4; ++s) {
+				if (s == 1 || s == 2) {				// the 4th stage reuses the 3rd stage's f
+					vector<double> stage = y;
+					for (int j = 0; j < s; ++j)
+						for (size_t i = 0; i < n; ++i)
+							stage[i] += ros_a[s][j]*g[j][i];
+					dy = rates(f, t + ros_ax[s]*h, stage);
+				}
+				for (size_t i = 0; i < n; ++i) {
+					double sum = 0;
+					for (int j = 0; j < s; ++j)
+						sum += ros_c[s][j]*g[j][i];
+					g[s][i] = dy[i] + h*ros_cx[s]*ft[i] + sum/h;
+				}
+				linear_solve(m, g[s]);
+			}
+			for (size_t i = 0; i < n; ++i) {
+				yn[i] = y[i];
+				err[i] = 0;
+				for (int s = 0; s < 4; ++s) {
+					yn[i] += ros_b[s]*g[s][i];
+					err[i] += ros_e[s]*g[s][i];
+				}
+			}
+			ratio = error_ratio(err, y, yn);
+			if (ratio <= 1) {
+				++implicit_steps;
+				t += h;
+				y = yn;
+				k[0] = rates(f, t, y);
+			}
+			h *= step_factor(ratio, 4);
+		}
+		for (const double v : y)
+			if (!isfinite(v))
+				throw runtime_error("odesolve: solution is not finite");
+	}
+	return y;
+}
+
+// Monte Carlo for montecarlo(), samples are drawn in fixed blocks each with its own
+// random stream, so results depend only on the seed and not on the number of threads
+constexpr int montecarlo_block = 4096;
+constexpr int mixed_check = 64;						// in mixed mode, one sample in this many is also
+													// evaluated in double to estimate the rounding error
+constexpr int quantile_samples = 1 << 20;			// at most this many evenly spaced samples are kept
+													// for the quantiles, so memory does not grow with n
+
+// mean of f over n samples, with its standard error and quantiles in the note
+double montecarlo(const Program& f, const double count) {
+	if (!(count >= 2) || count > 1e9)
+		throw runtime_error("montecarlo: sample count must be between 2 and 1e9");
+	const int n = static_cast<int>(count);
+	const int blocks = (n + montecarlo_block - 1) / montecarlo_block;
+	const uint64_t base = random_stream.next();		// so each call draws new samples
+	const int stride = (n + quantile_samples - 1) / quantile_samples;
+
+	// in mixed mode samples are evaluated in single precision, but summed in double
+	const bool single = mode == Mode::mixed;
+	struct Block {
+		double sum = 0;
+		double squares = 0;							// of the deviations from the block's mean
+		double rounding = 0;						// sum of |single - double| over the checked samples
+	};
+	vector<Block> stats(blocks);
+	vector<double> kept((n + stride - 1) / stride);
+	const Random_stream caller = random_stream;		// a block on this thread replaces it
+	try {
+		parallel_for(blocks, [&](const int b) {
+			random_stream = Random_stream{base, static_cast<uint64_t>(b)};
+			const int first = b*montecarlo_block;
+			const int size = min(n - first, montecarlo_block);
+			array<double, montecarlo_block> samples;
+			Block& s = stats[b];
+			for (int j = 0; j < size; ++j) {
+				const int i = first + j;
+				if (!single)
+					samples[j] = f.run();
+				else if (i % mixed_check != 0)
+					samples[j] = f.run(static_cast<const float*>(nullptr));
+				else {									// the same draws again, in double
+					const Random_stream start = random_stream;
+					samples[j] = f.run(static_cast<const float*>(nullptr));
+					random_stream = start;
+					s.rounding += abs(samples[j] - f.run());
+				}
+				s.sum += samples[j];
+				if (i % stride == 0)
+					kept[i / stride] = samples[j];
+			}
+			const double mean = s.sum / size;
+			for (int j = 0; j < size; ++j)
+				s.squares += (samples[j] - mean)*(samples[j] - mean);
+		});
+	}
+	catch (...) {
+		random_stream = caller;
+		throw;
+	}
+	random_stream = caller;
+
+	// combine the blocks in order, to not depend on the threads
+	double sum = 0;
+	double squares = 0;
+	double rounding = 0;
+	for (int b = 0; b < blocks; ++b) {
+		const double m = b*montecarlo_block;		// samples before block b
+		const double k = min(n - b*montecarlo_block, montecarlo_block);
+		if (b > 0) {
+			const double delta = stats[b].sum/k - sum/m;
+			squares += delta*delta * m*k / (m + k);
+		}
+		sum += stats[b].sum;
+		squares += stats[b].squares;
+		rounding += stats[b].rounding;
+	}
+	const double mean = sum / n;
+	const double stderror = sqrt(squares / (n - 1) / n);
+
+	ostringstream os;
+	os << "montecarlo: " << n << " samples, standard error " << stderror;
+	if (single)
+		os << ", mean rounding error in single precision " << rounding / ((n - 1) / mixed_check + 1);
+	for (const double q : {0.05, 0.5, 0.95}) {
+		const auto at = kept.begin() + static_cast<ptrdiff_t>(q*(kept.size() - 1));
+		ranges::nth_element(kept, at);
+		os << ", " << q*100 << "% " << *at;
+	}
+	if (stride > 1)
+		os << " (quantiles of one sample in " << stride << ")";
+	note = os.str();
+	return mean;
+}
+
+// a builtin function: the parser finds it by name, and evaluate() and deriv take its kernel,
+// derivative and call from here; compiled formulas switch on sqrt, interp and the elementary
+// functions, which they evaluate in their own type, and take the kernel of the others, and
+// the other modes' evaluate_as<T> dispatch on the kind themselves
+constexpr int any_number = numeric_limits<int>::max();
+constexpr int local_arguments = 4;					// kernel arguments passed without allocation
+
+const Builtin builtins[] = {
+	{t_sqrt, sqrtkey, 1, 1, true, true, [](const double* a, int) {
+		if (a[0] < 0)
+			throw runtime_error("cannot get square root of negative number");
+		return sqrt(a[0]);
+	}, [](const Expr& e, const string& var) {		// u' / 2*sqrt(u)
+		return Expr{'/', {derivative(e.args[0], var), Expr{'*', {Expr{t_number, 2.0}, e}}}};
+	}},
+	{t_pow, powkey, 2, 2, true, true, [](const double* a, int) { return elementary(t_pow, a); },
+	[](const Expr& e, const string& var) {			// n * pow(u, n-1) * u'
+		const Expr& u = e.args[0];
+		const Expr& n = e.args[1];
+		if (depends_on(n, var)) {					// pow(u, n) * (n' log(u) + n u' / u)
+			const Expr by_n{'*', {derivative(n, var), Expr{t_log, {u}}}};
+			const Expr by_u{'/', {Expr{'*', {n, derivative(u, var)}}, u}};
+			return Expr{'*', {e, Expr{'+', {by_n, by_u}}}};
+		}
+		const Expr lower{t_pow, {u, Expr{'-', {n, Expr{t_number, 1.0}}}}};
+		return Expr{'*', {Expr{'*', {n, lower}}, derivative(u, var)}};
+	}},
+	{t_powmod, powmodkey, 3, 3, true, true, [](const double* a, int) { return powmod(a[0], a[1], a[2]); }},
+	{t_isprime, isprimekey, 1, 1, true, true, [](const double* a, int) { return number_theory(t_isprime, a[0]); }},
+	{t_nextprime, nextprimekey, 1, 1, true, true, [](const double* a, int) { return number_theory(t_nextprime, a[0]); }},
+	{t_primepi, primepikey, 1, 1, true, true, [](const double* a, int) { return number_theory(t_primepi, a[0]); }},
+	{t_factor, factorkey, 1, 1, false, true, [](const double* a, int) { return number_theory(t_factor, a[0]); },
+	nullptr, [](const Expr& e) {					// with the whole factorization in the note
+		const double d = evaluate(e.args[0]);
+		const double r = number_theory(t_factor, d);
+		note = factorization(static_cast<uint64_t>(d));
+		return r;
+	}},
+	{t_ncr, ncrkey, 2, 2, true, true, [](const double* a, int) { return combinations(t_ncr, vector<double>{a[0], a[1]}); }},
+	{t_npr, nprkey, 2, 2, true, true, [](const double* a, int) { return combinations(t_npr, vector<double>{a[0], a[1]}); }},
+	{t_multinomial, multinomialkey, 1, any_number, true, true, [](const double* a, const int n) {
+		return combinations(t_multinomial, vector<double>(a, a + n));
+	}},
+	{t_exp, expkey, 1, 1, true, true, [](const double* a, int) { return elementary(t_exp, a); },
+	[](const Expr& e, const string& var) {			// exp(u) * u'
+		return Expr{'*', {e, derivative(e.args[0], var)}};
+	}},
+	{t_log, logkey, 1, 1, true, true, [](const double* a, int) { return elementary(t_log, a); },
+	[](const Expr& e, const string& var) {			// u' / u
+		return Expr{'/', {derivative(e.args[0], var), e.args[0]}};
+	}},
+	{t_sin, sinkey, 1, 1, true, true, [](const double* a, int) { return elementary(t_sin, a); },
+	[](const Expr& e, const string& var) {			// cos(u) * u'
+		return Expr{'*', {Expr{t_cos, {e.args[0]}}, derivative(e.args[0], var)}};
+	}},
+	{t_cos, coskey, 1, 1, true, true, [](const double* a, int) { return elementary(t_cos, a); },
+	[](const Expr& e, const string& var) {			// -sin(u) * u'
+		return Expr{'*', {Expr{'-', {Expr{t_sin, {e.args[0]}}}}, derivative(e.args[0], var)}};
+	}},
+	{t_tan, tankey, 1, 1, true, true, [](const double* a, int) { return elementary(t_tan, a); },
+	[](const Expr& e, const string& var) {			// u' / cos(u)*cos(u)
+		const Expr c{t_cos, {e.args[0]}};
+		return Expr{'/', {derivative(e.args[0], var), Expr{'*', {c, c}}}};
+	}},
+	{t_atan2, atan2key, 2, 2, true, true, [](const double* a, int) { return elementary(t_atan2, a); },
+	[](const Expr& e, const string& var) {			// (x y' - y x') / (x*x + y*y) for atan2(y, x)
+		const Expr& y = e.args[0];
+		const Expr& x = e.args[1];
+		const Expr top{'-', {Expr{'*', {x, derivative(y, var)}}, Expr{'*', {y, derivative(x, var)}}}};
+		return Expr{'/', {top, Expr{'+', {Expr{'*', {x, x}}, Expr{'*', {y, y}}}}}};
+	}},
+	{t_tanh, tanhkey, 1, 1, true, true, [](const double* a, int) { return elementary(t_tanh, a); },
+	[](const Expr& e, const string& var) {			// (1 - tanh(u)*tanh(u)) * u'
+		return Expr{'*', {Expr{'-', {Expr{t_number, 1.0}, Expr{'*', {e, e}}}}, derivative(e.args[0], var)}};
+	}},
+	{t_erf, erfkey, 1, 1, true, true, [](const double* a, int) { return elementary(t_erf, a); },
+	[](const Expr& e, const string& var) {			// 2/sqrt(pi) * exp(-u*u) * u'
+		const Expr& u = e.args[0];
+		const Expr gauss{t_exp, {Expr{'-', {Expr{'*', {u, u}}}}}};
+		const Expr scale{t_number, 2 / sqrt(numbers::pi)};
+		return Expr{'*', {Expr{'*', {scale, gauss}}, derivative(u, var)}};
+	}},
+	{t_interp, interpkey, 2, 2, false, true, nullptr, nullptr, [](const Expr& e) {	// of a table name, not a value
+		return symbols.get_table(e.args[0].name)(evaluate(e.args[1]));
+	}},
+	{t_if, ifkey, 3, 3, true, true, nullptr, [](const Expr& e, const string& var) {	// if(c, a', b')
+		return Expr{t_if, {e.args[0], derivative(e.args[1], var), derivative(e.args[2], var)}};
+	}, [](const Expr& e) {							// only the branch taken is evaluated
+		return evaluate(e.args[0]) != 0 ? evaluate(e.args[1]) : evaluate(e.args[2]);
+	}},
+	{t_deriv, derivkey, 2, 2, true, true, nullptr},		// replaced by the derivative when parsed
+	{t_solve, solvekey, 3, 4, false, false, nullptr, nullptr, [](const Expr& e) {
+		const Program f{e.args[0], {e.args[1].name}};
+		if (e.args.size() == 3)
+			return find_root(f, evaluate(e.args[2]));
+		return find_root(f, evaluate(e.args[2]), evaluate(e.args[3]));
+	}},
+	{t_integrate, integratekey, 4, 4, false, false, nullptr, nullptr, [](const Expr& e) {
+		const Program f{e.args[0], {e.args[1].name}};
+		return integrate(f, evaluate(e.args[2]), evaluate(e.args[3]));
+	}},
+	{t_minimize, minimizekey, 3, any_number, false, false, nullptr, nullptr, [](const Expr& e) {
+		const size_t n = e.args.size() / 2;
+		vector<string> names;
+		vector<double> start;
+		for (size_t i = 1; i <= n; ++i) {
+			names.push_back(e.args[i].name);
+			start.push_back(evaluate(e.args[n+i]));
+		}
+		return minimize(Program{e.args[0], names}, names, start);
+	}},
+	{t_odesolve, odesolvekey, 6, any_number, false, false, nullptr, nullptr, [](const Expr& e) {
+		const size_t n = e.args.size()/3 - 1;
+		vector<string> names;
+		for (size_t i = n; i <= 2*n; ++i)
+			names.push_back(e.args[i].name);
+		vector<Program> f;
+		vector<double> y;
+		for (size_t i = 0; i < n; ++i) {
+			f.emplace_back(e.args[i], names);
+			y.push_back(evaluate(e.args[2*n+2+i]));
+		}
+		const double t1 = evaluate(e.args[3*n+2]);
+
+		int rk_steps;
+		int implicit_steps;
+		y = odesolve(f, evaluate(e.args[2*n+1]), y, t1, rk_steps, implicit_steps);
+
+		ostringstream os;
+		os << "odesolve: at " << names[0] << " = " << t1;
+		for (size_t i = 0; i < n; ++i)
+			os << ", " << names[i+1] << " = " << y[i];
+		os << " after " << rk_steps << " RK45 steps";
+		if (implicit_steps > 0)
+			os << " and " << implicit_steps << " implicit steps";
+		note = os.str();
+		return y[0];
+	}},
+	{t_rand, randkey, 0, 0, false, true, [](const double*, int) { return random_stream.uniform(); },
+	[](const Expr&, const string&) { return Expr{t_number, 0.0}; }},
+	{t_randn, randnkey, 0, 0, false, true, [](const double*, int) { return random_stream.normal(); },
+	[](const Expr&, const string&) { return Expr{t_number, 0.0}; }},
+	{t_seed, seedkey, 1, 1, false, false, nullptr, nullptr, [](const Expr& e) {
+		const double d = evaluate(e.args[0]);
+		if (!(d >= 0 && d < 0x1p64) || d != trunc(d))
+			throw runtime_error(seedkey + ": integer from 0 to 2^64 - 1 expected");
+		random_stream = Random_stream{static_cast<uint64_t>(d), 0};
+		return d;
+	}},
+	{t_montecarlo, montecarlokey, 2, 2, false, false, nullptr, nullptr, [](const Expr& e) {
+		return montecarlo(Program{e.args[0], {}}, evaluate(e.args[1]));
+	}},
+};
+
+// the builtins indexed by kind, so that dispatch is a single load
+const array<const Builtin*, 128> builtin_index = [] {
+	array<const Builtin*, 128> index{};
+	for (const Builtin& b : builtins)
+		index[static_cast<unsigned char>(b.kind)] = &b;
+	return index;
+}();
+
+// the builtin function with token kind k, or null
+const Builtin* builtin(const char k) {
+	return static_cast<unsigned char>(k) < builtin_index.size() ? builtin_index[static_cast<unsigned char>(k)] : nullptr;
+}
+
+// the builtin function called name, or null
+const Builtin* find_builtin(const string& name) {
+	const auto b = ranges::find_if(builtins, [&](const Builtin& f) { return f.name == name; });
+	return b != ranges::end(builtins) ? &*b : nullptr;
+}
+
+// compute the value of e using the current values of its variables
+double evaluate(const Expr& e) {
+	switch (e.kind) {
+		case t_number:
+			return e.value;
+		case t_name:
+			return symbols.get_value(e.name);
+		case '+':
+			return evaluate(e.args[0]) + evaluate(e.args[1]);
+		case '-':
+			if (e.args.size() == 1)
+				return - evaluate(e.args[0]);
+			return evaluate(e.args[0]) - evaluate(e.args[1]);
+		case '*':
+			return evaluate(e.args[0]) * evaluate(e.args[1]);
+		case '/':
+		{
+			const double left = evaluate(e.args[0]);
+			const double d = evaluate(e.args[1]);
+			if (d == 0)
+				throw runtime_error("divide by zero");
+			return left / d;
+		}
+		case '%':
+		{
+			const double left = evaluate(e.args[0]);
+			const double d = evaluate(e.args[1]);
+			if (d == 0)
+				throw runtime_error("%: divide by zero");
+			return fmod(left, d);
+		}
+		case '!':
+			return factorial(evaluate(e.args[0]));
+		case '<':
+		case t_less_equal:
+		case '>':
+		case t_greater_equal:
+		case t_equal:
+		case t_not_equal:
+			return compare(e.kind, evaluate(e.args[0]), evaluate(e.args[1]));
+		default:
+		{
+			const Builtin* b = builtin(e.kind);
+			if (b && b->call)
+				return b->call(e);
+			if (!b || !b->kernel)
+				throw runtime_error("function not implemented");
+			const int n = static_cast<int>(e.args.size());
+			double local[local_arguments];
+			vector<double> heap(n > local_arguments ? n : 0);	// only for functions of many arguments
+			double* a = n > local_arguments ? heap.data() : local;
+			for (int i = 0; i < n; ++i)
+				a[i] = evaluate(e.args[i]);
+			return b->kernel(a, n);
+		}
+	}
+}
+
+// return the name of the function with token kind k
+const string& function_key(const char k) {
+	if (const Builtin* b = builtin(k))
+		return b->name;
+	throw runtime_error("function not implemented");
+}
+
+// binding strength of e when printed, higher binds tighter
+int precedence(const Expr& e) {
+	switch (e.kind) {
+		case '<':
+		case t_less_equal:
+		case '>':
+		case t_greater_equal:
+		case t_equal:
+		case t_not_equal:
+			return 0;
+		case '+':
+			return 1;
+		case '-':
+			return e.args.size() == 1 ? 4 : 1;
+		case '*':
+		case '/':
+		case '%':
+			return 2;
+		case '!':
+			return 5;
+		case t_number:
+			return e.value < 0 ? 4 : 6;
+		default:
+			return 6;
+	}
+}
+
+// write e, in parentheses if it binds looser than prec
+void print_operand(ostream& os, const Expr& e, const int prec) {
+	if (precedence(e) < prec)
+		os << '(' << e << ')';
+	else
+		os << e;
+}
+
+// write e using the calculator's own syntax, so it can be read back in
+ostream& operator<<(ostream& os, const Expr& e) {
+	switch (e.kind) {
+		case t_number:								// a literal as written, so it reads back the same
+			return e.name.empty() ? os << e.value : os << e.name;
+		case t_name:
+			return os << e.name;
+		case '-':
+			if (e.args.size() == 1) {
+				os << '-';
+				print_operand(os, e.args[0], 6);
+				return os;
+			}
+			[[fallthrough]];
+		case '+':
+		case '*':
+		case '/':
+		case '%':
+		{
+			const int prec = precedence(e);
+			print_operand(os, e.args[0], prec);
+			os << (prec == 1 ? " " : "") << e.kind << (prec == 1 ? " " : "");
+			print_operand(os, e.args[1], prec+1);
+			return os;
+		}
+		case '!':
+			print_operand(os, e.args[0], 5);
+			return os << '!';
+		case '<':
+		case t_less_equal:
+		case '>':
+		case t_greater_equal:
+		case t_equal:
+		case t_not_equal:
+			print_operand(os, e.args[0], 0);
+			os << ' ' << comparison_key(e.kind) << ' ';
+			print_operand(os, e.args[1], 1);
+			return os;
+		default:									// function call
+			os << function_key(e.kind) << '(';
+			for (size_t i = 0; i < e.args.size(); ++i)
+				os << (i == 0 ? "" : ", ") << e.args[i];
+			return os << ')';
+	}
+}
+
+Program::Program(const Expr& e, const vector<string>& params) {
+	int height = 0;
+	emit(e, params, height);
+}
+
+// the most operations in the two branches of an if that are both computed; a mispredicted
+// jump costs about as much as running a few instructions, so only tiny branches gain
+constexpr int max_selected_size = 4;
+
+// whether e can be computed even where it is not needed, so that an if can select between its
+// branches without a jump: small branches of parameters and real constants that cannot fail
+// and have no effects, such as drawing random numbers; size counts the operations seen so far
+bool Program::selectable(const Expr& e, const vector<string>& params, int& size) {
+	switch (e.kind) {
+		case t_name:								// a variable can become complex, and reading
+			if (ranges::find(params, e.name) == params.end() && !symbols.is_real_constant(e.name))
+				return false;						// a table or a formula can fail
+			[[fallthrough]];
+		case t_number:
+		case '+':
+		case '-':
+		case '*':
+		case '<':
+		case t_less_equal:
+		case '>':
+		case t_greater_equal:
+		case t_equal:
+		case t_not_equal:
+		case t_if:
+			return ++size <= max_selected_size
+				&& ranges::all_of(e.args, [&](const Expr& a) { return selectable(a, params, size); });
+		default:
+			return false;
+	}
+}
+
+// append the code for e, tracking the stack height it reaches
+void Program::emit(const Expr& e, const vector<string>& params, int& height) {
+	if (const Builtin* b = builtin(e.kind); b && !b->compiled)
+		throw runtime_error(b->name + ": cannot be used in a formula");
+	if (e.kind == t_interp) {						// the table is named by index, not pushed
+		emit(e.args[1], params, height);
+		code.push_back(Instr{t_interp, 0, symbols.index_of(e.args[0].name)});
+		return;
+	}
+	if (int size = 0; e.kind == t_if && !(selectable(e.args[1], params, size) && selectable(e.args[2], params, size))) {
+		emit(e.args[0], params, height);
+		const size_t branch = code.size();
+		code.push_back(Instr{t_branch, 0, 0});
+		--height;
+		emit(e.args[1], params, height);
+		const size_t jump = code.size();
+		code.push_back(Instr{t_jump, 0, 0});
+		code[branch].index = static_cast<int>(code.size());
+		--height;									// the other branch starts from the same height
+		emit(e.args[2], params, height);
+		code[jump].index = static_cast<int>(code.size());
+		return;
+	}
+	for (const Expr& a : e.args)
+		emit(a, params, height);
+
+	switch (e.kind) {
+		case t_number:
+			code.push_back(Instr{t_number, e.value, 0});
+			++height;
+			break;
+		case t_name:
+		{
+			const auto p = ranges::find(params, e.name);
+			if (p != params.end())
+				code.push_back(Instr{t_param, 0, static_cast<int>(p - params.begin())});
+			else
+				code.push_back(Instr{t_name, 0, symbols.index_of(e.name)});
+			++height;
+			break;
+		}
+		case '-':
+			if (e.args.size() == 1) {
+				code.push_back(Instr{t_neg, 0, 0});
+				break;
+			}
+			[[fallthrough]];
+		default:
+			code.push_back(Instr{e.kind, 0, static_cast<int>(e.args.size())});
+			height -= static_cast<int>(e.args.size()) - 1;
+	}
+	depth = max(depth, height);
+}
+
+// evaluate the program with its parameters bound to args
+double Program::run(const double* args) const {
+	return exec(args);
+}
+
+// evaluate the program and its derivative, args carry the derivatives of the parameters
+Dual Program::run(const Dual* args) const {
+	return exec(args);
+}
+
+float Program::run(const float* args) const {
+	return exec(args);
+}
+
+template<class T> T Program::exec(const T* args) const {
+	constexpr int local_depth = 64;
+	T local[local_depth] {};
+	vector<T> heap;									// only for unusually deep expressions
+	T* s = local;
+	if (depth > local_depth) {
+		heap.resize(depth);
+		s = heap.data();
+	}
+
+	int top = -1;
+	for (size_t next = 0; next < code.size(); ++next) {
+		const auto&[op, value, index] = code[next];
+		switch (op) {
+			case t_number:
+				s[++top] = static_cast<T>(value);
+				break;
+			case t_param:
+				s[++top] = args[index];
+				break;
+			case t_name:
+				s[++top] = static_cast<T>(symbols.value_at(index));
+				break;
+			case t_neg:
+				s[top] = -s[top];
+				break;
+			case '+':
+				--top;
+				s[top] = s[top] + s[top+1];
+				break;
+			case '-':
+				--top;
+				s[top] = s[top] - s[top+1];
+				break;
+			case '*':
+				--top;
+				s[top] = s[top] * s[top+1];
+				break;
+			case '/':
+				--top;
+				if (value_of(s[top+1]) == 0)
+					throw runtime_error("divide by zero");
+				s[top] = s[top] / s[top+1];
+				break;
+			case '%':
+				--top;
+				if (value_of(s[top+1]) == 0)
+					throw runtime_error("%: divide by zero");
+				s[top] = fmod(s[top], s[top+1]);
+				break;
+			case '!':
+				s[top] = factorial(s[top]);
+				break;
+			case '<':
+			case t_less_equal:
+			case '>':
+			case t_greater_equal:
+			case t_equal:
+			case t_not_equal:
+				--top;
+				s[top] = static_cast<T>(compare(op, value_of(s[top]), value_of(s[top+1])));
+				break;
+			case t_if:									// both branches computed, select by address
+				top -= 2;
+				s[top] = s[top + 1 + (value_of(s[top]) == 0)];
+				break;
+			case t_branch:
+				if (value_of(s[top--]) == 0)
+					next = index - 1;
+				break;
+			case t_jump:
+				next = index - 1;
+				break;
+			case t_sqrt:
+				if (value_of(s[top]) < 0)
+					throw runtime_error("cannot get square root of negative number");
+				s[top] = sqrt(s[top]);
+				break;
+			case t_interp:
+				s[top] = interpolate(symbols.table_at(index), s[top]);
+				break;
+			case t_pow:
+			case t_exp:
+			case t_log:
+			case t_sin:
+			case t_cos:
+			case t_tan:
+			case t_atan2:
+			case t_tanh:
+			case t_erf:
+				top -= index - 1;
+				s[top] = elementary(op, &s[top]);
+				break;
+			default:								// the builtin's kernel, in double with derivative zero
+			{
+				const Builtin* b = builtin(op);
+				if (!b || !b->kernel)
+					throw runtime_error("function not implemented");
+				top -= index - 1;					// index is the number of arguments
+				double local_args[local_arguments];
+				vector<double> heap_args(index > local_arguments ? index : 0);
+				double* a = index > local_arguments ? heap_args.data() : local_args;
+				for (int i = 0; i < index; ++i)
+					a[i] = value_of(s[top+i]);
+				s[top] = static_cast<T>(b->kernel(a, index));
+				break;
+			}
+		}
+	}
+	return s[top];
+}
+
+// what the evaluator needs of a number type T beyond its arithmetic operators, for
+// each mode's instantiation of evaluate_as<T>
+template<class T> struct Numeric;
+
+// whether a k b holds for the comparison k, from the sign of a - b, for the types whose
+// subtraction neither overflows nor rounds a difference to zero
+template<class T> bool compare_difference(const char k, const T& a, const T& b) {
+	const T d = a - b;
+	return compare(k, Numeric<T>::is_zero(d) ? 0 : Numeric<T>::is_negative(d) ? -1 : 1, 0);
+}
+
+template<floating_point T> struct Numeric<T> {
+	static const string& name() {
+		if constexpr (is_same_v<T, float>)
+			return singlekey;
+		else if constexpr (is_same_v<T, double>)
+			return floatkey;
+		else
+			return extendedkey;
+	}
+	static T literal(const Expr& e) {				// long double reads the literal's text for its extra digits
+		if constexpr (is_same_v<T, long double>)
+			if (!e.name.empty())
+				return strtold(e.name.c_str(), nullptr);
+		return static_cast<T>(e.value);
+	}
+	static T variable(const string& s) { return static_cast<T>(symbols.get_value(s)); }
+	static double stored(const T x) { return static_cast<double>(x); }
+	static bool is_zero(const T x) { return x == 0; }
+	static bool is_negative(const T x) { return x < 0; }
+	static bool compare(const char k, const T a, const T b) { return ::compare(k, a, b); }
+	static T remainder(const T a, const T b) { return fmod(a, b); }
+	static T factorial(const T x) { return ::factorial(x); }
+	static T root(const T x) { return sqrt(x); }
+	static T power(const T a, const T b) { return pow(a, b); }
+	static T power_mod(const T b, const T e, const T m) { return static_cast<T>(powmod(b, e, m)); }
+	static T elementary(const char k, const T* a) { return ::elementary(k, a); }
+	static T interpolate(const Table& t, const T x) { return ::interpolate(t, x); }
+	static uint64_t natural(const char k, const T x) { return ::natural(k, static_cast<double>(x)); }
+	static T from_natural(const uint64_t n) { return static_cast<T>(n); }
+	static T combinations(const char k, const vector<uint64_t>& a) { return static_cast<T>(::combinations(k, a)); }
+};
+
+template<> struct Numeric<Checked> {
+	static const string& name() { return integerkey; }
+	static Checked literal(const Expr& e) {		// the text is only needed where doubles are not exact
+		if (abs(e.value) >= 0x1p53 && !e.name.empty() && ranges::all_of(e.name, [](const char c) { return isdigit(c); })) {
+			Checked x;
+			if (from_chars(e.name.data(), e.name.data() + e.name.size(), x.v).ec != errc{})
+				throw runtime_error(integerkey + ": " + e.name + " out of range");
+			return x;
+		}
+		return Checked::from_double(e.value);
+	}
+	static Checked variable(const string& s) { return Checked::from_double(symbols.get_value(s)); }
+	static double stored(const Checked x) {
+		const double d = static_cast<double>(x.v);
+		if (d >= 0x1p63 || static_cast<int64_t>(d) != x.v)
+			throw runtime_error(integerkey + ": value too large to store in a variable");
+		return d;
+	}
+	static bool is_zero(const Checked x) { return x.v == 0; }
+	static bool is_negative(const Checked x) { return x.v < 0; }
+	static bool compare(const char k, const Checked a, const Checked b) { return ::compare(k, a.v, b.v); }
+	static Checked remainder(const Checked a, const Checked b) { return a % b; }
+	static Checked factorial(const Checked n) { return Checked{checked_factorial(n.v)}; }
+	static Checked root(const Checked x) {
+		int64_t r = static_cast<int64_t>(sqrt(static_cast<double>(x.v)));	// may be one off
+		while (int128{r}*r > x.v)
+			--r;
+		while (int128{r + 1}*(r + 1) <= x.v)
+			++r;
+		if (r*r != x.v)
+			throw runtime_error(integerkey + ": square root is not an integer");
+		return Checked{r};
+	}
+	static Checked power(Checked a, Checked n) {
+		if (n.v < 0)
+			throw runtime_error(integerkey + ": negative exponent");
+		Checked r{1};
+		for (; n.v != 0; n.v >>= 1) {
+			if (n.v & 1)
+				r = r * a;
+			if (n.v > 1)
+				a = a * a;
+		}
+		return r;
+	}
+	static Checked power_mod(const Checked b, const Checked e, const Checked m) {
+		if (e.v < 0)
+			throw runtime_error(powmodkey + ": negative exponent");
+		if (m.v < 1)
+			throw runtime_error(powmodkey + ": modulus must be positive");
+		const int64_t base = b.v % m.v;
+		const auto r = powmod(static_cast<uint64_t>(base < 0 ? base + m.v : base),
+			Bigint::from_unsigned(static_cast<uint64_t>(e.v)).mag, static_cast<uint64_t>(m.v));
+		return Checked{static_cast<int64_t>(r)};
+	}
+	static uint64_t natural(const char k, const Checked x) {
+		if (x.v < 0)
+			throw runtime_error(function_key(k) + ": negative argument");
+		return static_cast<uint64_t>(x.v);
+	}
+	static Checked from_natural(const uint64_t n) {
+		if (n > uint64_t{numeric_limits<int64_t>::max()})
+			throw runtime_error(integerkey + ": overflow");
+		return Checked{static_cast<int64_t>(n)};
+	}
+	static Checked combinations(const char k, const vector<uint64_t>& a) {
+		uint64_t c;
+		if (!small_combinations(k, a, c))
+			throw runtime_error(integerkey + ": overflow");
+		return from_natural(c);
+	}
+};
+
+template<> struct Numeric<Bigint> {
+	static const string& name() { return exactkey; }
+	static Bigint literal(const Expr& e) {
+		if (!e.name.empty() && ranges::all_of(e.name, [](const char c) { return isdigit(c); }))
+			return Bigint::from_string(e.name);
+		return Bigint::from_double(e.value);
+	}
+	static Bigint variable(const string& s) { return Bigint::from_double(symbols.get_value(s)); }
+	static double stored(const Bigint& x) {
+		const double d = x.to_double();
+		if (!isfinite(d) || !(Bigint::from_double(d) == x))
+			throw runtime_error("exact: value too large to store in a variable");
+		return d;
+	}
+	static bool is_zero(const Bigint& x) { return x.is_zero(); }
+	static bool is_negative(const Bigint& x) { return x.negative; }
+	static bool compare(const char k, const Bigint& a, const Bigint& b) { return compare_difference(k, a, b); }
+	static Bigint remainder(const Bigint& a, const Bigint& b) { return a % b; }
+	static Bigint factorial(const Bigint& n) {
+		if (n.negative)
+			throw runtime_error("cannot get factorial of negative number.");
+		if (n.mag.size() > 1)
+			throw runtime_error("exact: factorial argument too large");
+		return exact_factorial(n.is_zero() ? 0 : n.mag[0]);
+	}
+	static Bigint root(const Bigint& x) {
+		Bigint r = isqrt(x);
+		if (!(r*r == x))
+			throw runtime_error("exact: square root is not an integer");
+		return r;
+	}
+	static Bigint power(const Bigint& a, const Bigint& n) {
+		if (n.negative)
+			throw runtime_error("exact: negative exponent");
+		if (n.mag.size() > 2)
+			throw runtime_error("exact: exponent too large");
+		return pow(a, to_uint64(n.mag));
+	}
+	static Bigint power_mod(const Bigint& b, const Bigint& e, const Bigint& m) {
+		if (e.negative)
+			throw runtime_error(powmodkey + ": negative exponent");
+		if (m.negative || m.is_zero())
+			throw runtime_error(powmodkey + ": modulus must be positive");
+		return powmod(b, e, m);
+	}
+	static uint64_t natural(const char k, const Bigint& x) {
+		if (x.negative)
+			throw runtime_error(function_key(k) + ": negative argument");
+		if (x.mag.size() > 2)
+			throw runtime_error(function_key(k) + ": argument must be below 2^64");
+		return to_uint64(x.mag);
+	}
+	static Bigint from_natural(const uint64_t n) { return Bigint::from_unsigned(n); }
+	static Bigint combinations(const char k, const vector<uint64_t>& a) { return exact_combinations(k, a); }
+};
+
+template<> struct Numeric<Bigfloat> {
+	static const string& name() { return precisionkey; }
+	static Bigfloat literal(const Expr& e) {
+		if (e.name.empty())
+			return Bigfloat::from_double(e.value);
+		return Bigfloat::from_string(e.name);
+	}
+	static Bigfloat variable(const string& s) {
+		if (s == "pi")								// the predefined constants to full precision
+			return pi_constant();
+		if (s == "e")
+			return exp(Bigfloat{1});
+		return Bigfloat::from_double(symbols.get_value(s));
+	}
+	static double stored(const Bigfloat& x) {
+		const double d = x.to_double();
+		if (!isfinite(d))
+			throw runtime_error(precisionkey + ": value too large to store in a variable");
+		return d;
+	}
+	static bool is_zero(const Bigfloat& x) { return x.is_zero(); }
+	static bool is_negative(const Bigfloat& x) { return x.mant.negative; }
+	static bool compare(const char k, const Bigfloat& a, const Bigfloat& b) { return compare_difference(k, a, b); }
+	static Bigfloat remainder(const Bigfloat& a, const Bigfloat& b) { return fmod(a, b); }
+	static Bigfloat factorial(const Bigfloat& x) { return ::factorial(x); }
+	static Bigfloat root(const Bigfloat& x) { return sqrt(x); }
+	static Bigfloat power(const Bigfloat& a, const Bigfloat& b) { return pow(a, b); }
+	static Bigfloat power_mod(const Bigfloat& b, const Bigfloat& e, const Bigfloat& m) {
+		const auto integer = [](const Bigfloat& x) {
+			if (!x.is_integer() || x.exp > max_precision)
+				throw runtime_error(powmodkey + ": integer arguments below 2^" + to_string(max_precision) + " expected");
+			return x.mant.shifted(static_cast<int>(x.exp));
+		};
+		return Bigfloat{Numeric<Bigint>::power_mod(integer(b), integer(e), integer(m)), 0};
+	}
+};
+
+template<> struct Numeric<Rational> {
+	static const string& name() { return rationalkey; }
+	static Rational literal(const Expr& e) {
+		if (e.name.empty())
+			return Rational::from_double(e.value);
+		return Rational::from_string(e.name);
+	}
+	static Rational variable(const string& s) { return Rational::from_double(symbols.get_value(s)); }
+	static double stored(const Rational& x) {
+		const double d = x.to_double();
+		if (!isfinite(d))
+			throw runtime_error(rationalkey + ": value too large to store in a variable");
+		return d;
+	}
+	static bool is_zero(const Rational& x) { return x.is_zero(); }
+	static bool is_negative(const Rational& x) { return x.is_negative(); }
+	static bool compare(const char k, const Rational& a, const Rational& b) { return compare_difference(k, a, b); }
+	static Rational remainder(const Rational& a, const Rational& b) {
+		const Rational q = a / b;
+		return a - Rational{q.numerator() / q.denominator(), Bigint{1}} * b;
+	}
+	static Rational factorial(const Rational& x) {
+		const Bigint n = integer(x, "factorial of a fraction");
+		if (n.negative)
+			throw runtime_error("cannot get factorial of negative number.");
+		if (n.mag.size() > 1)
+			throw runtime_error(rationalkey + ": factorial argument too large");
+		return Rational{exact_factorial(n.is_zero() ? 0 : n.mag[0]), Bigint{1}};
+	}
+	static Rational root(const Rational& x) {
+		const Rational r = reduced(x);
+		const Bigint n = isqrt(r.numerator());
+		const Bigint d = isqrt(r.denominator());
+		if (!(n*n == r.numerator()) || !(d*d == r.denominator()))
+			throw runtime_error(rationalkey + ": square root is not rational");
+		return Rational{n, d};
+	}
+	static Rational power(const Rational& a, const Rational& b) {
+		const Bigint n = integer(b, "exponent must be an integer");
+		if (n.mag.size() > 2)
+			throw runtime_error(rationalkey + ": exponent too large");
+		const uint64_t e = to_uint64(n.mag);
+		if (!n.negative)
+			return Rational{pow(a.numerator(), e), pow(a.denominator(), e)};
+		if (a.is_zero())
+			throw runtime_error("divide by zero");
+		return Rational{pow(a.denominator(), e), pow(a.numerator(), e)};
+	}
+	static Rational power_mod(const Rational& b, const Rational& e, const Rational& m) {
+		const string message = powmodkey + " of a fraction";
+		return Rational{Numeric<Bigint>::power_mod(integer(b, message), integer(e, message), integer(m, message)), Bigint{1}};
+	}
+private:
+	static Bigint integer(const Rational& x, const string& message) {	// x, which must be an integer
+		const Rational r = reduced(x);
+		if (!(r.denominator() == Bigint{1}))
+			throw runtime_error(rationalkey + ": " + message);
+		return r.numerator();
+	}
+};
+
+template<> struct Numeric<Fixed> {
+	static const string& name() { return fixedkey; }
+	static Fixed literal(const Expr& e) {
+		if (e.name.empty())
+			return Fixed::from_double(e.value);
+		return Fixed::from_rational(Rational::from_string(e.name));
+	}
+	static Fixed variable(const string& s) { return Fixed::from_double(symbols.get_value(s)); }
+	static double stored(const Fixed x) { return x.to_double(); }
+	static bool is_zero(const Fixed x) { return x.v == 0; }
+	static bool is_negative(const Fixed x) { return x.v < 0; }
+	static bool compare(const char k, const Fixed a, const Fixed b) { return ::compare(k, a.v, b.v); }
+	static Fixed remainder(const Fixed a, const Fixed b) { return a % b; }
+	static Fixed factorial(const Fixed x) {
+		return fixed_result(int128{checked_factorial(integer(x, "factorial of a fraction"))} * decimal_powers[fixed_scale]);
+	}
+	static Fixed root(const Fixed x) {			// the square root of the raw value * 10^scale, rounded
+		const int128 n = int128{x.v} * decimal_powers[fixed_scale];
+		int128 r = static_cast<int128>(sqrt(static_cast<double>(n)));	// within a few units
+		while (r*r > n)
+			--r;
+		while ((r + 1)*(r + 1) <= n)
+			++r;
+		return fixed_result(n - r*r > r ? r + 1 : r);	// no ties, as n is an integer
+	}
+	static Fixed power(const Fixed a, const Fixed b) {	// exactly and then rounded once
+		const int64_t n = integer(b, "exponent must be an integer");
+		if (n > max_fixed_exponent || n < -max_fixed_exponent)
+			throw runtime_error(fixedkey + ": exponent too large");
+		const Rational base = Rational{a.v} / Rational{decimal_powers[fixed_scale]};
+		return Fixed::from_rational(Numeric<Rational>::power(base, Rational{n}));
+	}
+	static Fixed power_mod(const Fixed b, const Fixed e, const Fixed m) {
+		const string message = powmodkey + " of a fraction";
+		const Checked r = Numeric<Checked>::power_mod(Checked{integer(b, message)}, Checked{integer(e, message)},
+			Checked{integer(m, message)});
+		return fixed_result(int128{r.v} * decimal_powers[fixed_scale]);
+	}
+private:
+	static int64_t integer(const Fixed x, const string& message) {	// x, which must be an integer
+		if (x.v % decimal_powers[fixed_scale] != 0)
+			throw runtime_error(fixedkey + ": " + message);
+		return x.v / decimal_powers[fixed_scale];
+	}
+};
+
+template<> struct Numeric<Complex> {
+	static const string& name() { return complexkey; }
+	static Complex literal(const Expr& e) { return e.value; }
+	static Complex variable(const string& s) {
+		if (s == "i" && !symbols.is_declared(s))	// the imaginary unit, unless a variable takes the name
+			return {0, 1};
+		return symbols.get_complex(s);
+	}
+	static Complex stored(const Complex& x) { return x; }
+	static bool is_zero(const Complex& x) { return x == 0.0; }
+	static bool is_negative(const Complex&) { return false; }	// negative numbers have imaginary roots
+	static bool compare(const char k, const Complex& a, const Complex& b) {	// only real numbers are ordered
+		if (k == t_equal || k == t_not_equal)
+			return (a == b) == (k == t_equal);
+		return ::compare(k, real(a, comparison_key(k)), real(b, comparison_key(k)));
+	}
+	static Complex remainder(const Complex& a, const Complex& b) { return fmod(real(a, "%"), real(b, "%")); }
+	static Complex factorial(const Complex& x) { return ::factorial(real(x, "!")); }
+	static Complex root(const Complex& x) {			// +0 imaginary part, so that sqrt(-1) is i rather than -i
+		return sqrt(Complex{x.real(), x.imag() == 0 ? 0.0 : x.imag()});
+	}
+	static Complex power(Complex a, const Complex& b) {
+		if (a.imag() == 0 && b.imag() == 0 && (a.real() >= 0 || b.real() == trunc(b.real())))
+			return pow(a.real(), b.real());			// real, without rounding noise in the imaginary part
+		if (b.imag() == 0 && b.real() == trunc(b.real()) && abs(b.real()) <= max_square_exponent) {
+			Complex r = 1;							// by squaring, so that pow(i, 2) is exactly -1
+			for (auto n = static_cast<int64_t>(abs(b.real())); n != 0; n >>= 1) {
+				if (n & 1)
+					r *= a;
+				a *= a;
+			}
+			return b.real() < 0 ? 1.0 / r : r;
+		}
+		return pow(Complex{a.real(), a.imag() == 0 ? 0.0 : a.imag()}, b);	// +0 as in root()
+	}
+	static Complex power_mod(const Complex& b, const Complex& e, const Complex& m) {
+		return powmod(real(b, powmodkey), real(e, powmodkey), real(m, powmodkey));
+	}
+	static Complex elementary(const char k, const Complex* a) {	// atan2 and erf only of real numbers
+		switch (k) {
+			case t_log:								// +0 imaginary part, so that log(-1) is pi i
+				return log(Complex{a[0].real(), a[0].imag() == 0 ? 0.0 : a[0].imag()});
+			case t_atan2:
+				return atan2(real(a[0], atan2key), real(a[1], atan2key));
+			case t_erf:
+				return erf(real(a[0], erfkey));
+			case t_exp:
+				return exp(a[0]);
+			case t_sin:
+				return sin(a[0]);
+			case t_cos:
+				return cos(a[0]);
+			case t_tan:
+				return tan(a[0]);
+			default:
+				return tanh(a[0]);
+		}
+	}
+private:
+	static double real(const Complex& x, const string& op) {	// x, which must be real
+		if (x.imag() != 0)
+			throw runtime_error(op + ": not defined for complex numbers");
+		return x.real();
+	}
+};
+
+template<> struct Numeric<Modular> {
+	using Exponent = Bigint;						// exponents are integers, not residues
+	static const string& name() { return modularkey; }
+	static Modular literal(const Expr& e) {
+		if (!e.name.empty() && ranges::all_of(e.name, [](const char c) { return isdigit(c); }))
+			return Modular::from_bigint(Bigint::from_string(e.name));
+		return Modular::from_double(e.value);
+	}
+	static Modular variable(const string& s) { return Modular::from_double(symbols.get_value(s)); }
+	static double stored(const Modular x) {
+		if (x.v > uint64_t{1} << 53)
+			throw runtime_error(modularkey + ": value too large to store in a variable");
+		return static_cast<double>(x.v);
+	}
+	static bool is_zero(const Modular x) { return x.v == 0; }
+	static bool is_negative(const Modular) { return false; }
+	static bool compare(const char k, const Modular a, const Modular b) {
+		if (k != t_equal && k != t_not_equal)
+			throw runtime_error(comparison_key(k) + ": not available in " + modularkey + " mode");
+		return ::compare(k, a.v, b.v);
+	}
+	static Modular remainder(const Modular, const Modular) {
+		throw runtime_error("%: not available in " + modularkey + " mode");
+	}
+	static Modular factorial(const Modular n) {		// of the residue as an integer
+		if (n.v > max_modular_factorial)
+			throw runtime_error(modularkey + ": factorial argument too large");
+		Modular r{1 % modular_modulus};
+		for (uint64_t i = 2; i <= n.v && r.v != 0; ++i)
+			r = r * Modular{i % modular_modulus};
+		return r;
+	}
+	static Modular root(const Modular) {
+		throw runtime_error(sqrtkey + ": not available in " + modularkey + " mode");
+	}
+	static Modular power(const Modular a, const Bigint& n) {
+		const Modular r{powmod(a.v, n.mag, modular_modulus)};
+		return n.negative ? inverse(r) : r;
+	}
+};
+
+// value of e in the arithmetic of T; the numerical functions such as solve are
+// only available for double, which evaluate() handles
+template<class T> T evaluate_as(const Expr& e) {
+	using N = Numeric<T>;
+	switch (e.kind) {
+		case t_number:
+			return N::literal(e);
+		case t_name:
+			if (const Formula* f = symbols.get_formula(e.name))
+				return evaluate_as<T>(f->source);
+			return N::variable(e.name);
+		case '+':
+			return evaluate_as<T>(e.args[0]) + evaluate_as<T>(e.args[1]);
+		case '-':
+			if (e.args.size() == 1)
+				return - evaluate_as<T>(e.args[0]);
+			return evaluate_as<T>(e.args[0]) - evaluate_as<T>(e.args[1]);
+		case '*':
+			return evaluate_as<T>(e.args[0]) * evaluate_as<T>(e.args[1]);
+		case '/':
+		{
+			const T left = evaluate_as<T>(e.args[0]);
+			const T d = evaluate_as<T>(e.args[1]);
+			if (N::is_zero(d))
+				throw runtime_error("divide by zero");
+			return left / d;
+		}
+		case '%':
+		{
+			const T left = evaluate_as<T>(e.args[0]);
+			const T d = evaluate_as<T>(e.args[1]);
+			if (N::is_zero(d))
+				throw runtime_error("%: divide by zero");
+			return N::remainder(left, d);
+		}
+		case '!':
+			return N::factorial(evaluate_as<T>(e.args[0]));
+		case '<':
+		case t_less_equal:
+		case '>':
+		case t_greater_equal:
+		case t_equal:
+		case t_not_equal:
+		{
+			const bool holds = N::compare(e.kind, evaluate_as<T>(e.args[0]), evaluate_as<T>(e.args[1]));
+			return N::literal(Expr{t_number, holds ? 1.0 : 0.0});
+		}
+		case t_if:
+			return N::is_zero(evaluate_as<T>(e.args[0])) ? evaluate_as<T>(e.args[2]) : evaluate_as<T>(e.args[1]);
+		case t_sqrt:
+		{
+			const T d = evaluate_as<T>(e.args[0]);
+			if (N::is_negative(d))
+				throw runtime_error("cannot get square root of negative number");
+			return N::root(d);
+		}
+		case t_pow:
+			if constexpr (requires { typename N::Exponent; })
+				return N::power(evaluate_as<T>(e.args[0]), evaluate_as<typename N::Exponent>(e.args[1]));
+			else
+				return N::power(evaluate_as<T>(e.args[0]), evaluate_as<T>(e.args[1]));
+		case t_powmod:
+			if constexpr (requires (const T x) { N::power_mod(x, x, x); })
+				return N::power_mod(evaluate_as<T>(e.args[0]), evaluate_as<T>(e.args[1]), evaluate_as<T>(e.args[2]));
+			else
+				throw runtime_error(powmodkey + ": not available in " + N::name() + " mode");
+		case t_isprime:
+		case t_nextprime:
+		case t_primepi:
+		case t_factor:
+			if constexpr (requires (const T x) { N::natural(e.kind, x); }) {
+				const uint64_t n = N::natural(e.kind, evaluate_as<T>(e.args[0]));
+				const uint64_t r = number_theory(e.kind, n);
+				if (e.kind == t_factor)
+					note = factorization(n);
+				return N::from_natural(r);
+			}
+			else
+				throw runtime_error(function_key(e.kind) + ": not available in " + N::name() + " mode");
+		case t_exp:
+		case t_log:
+		case t_sin:
+		case t_cos:
+		case t_tan:
+		case t_atan2:
+		case t_tanh:
+		case t_erf:
+			if constexpr (requires (const T* a) { N::elementary(e.kind, a); }) {
+				T a[2];
+				for (size_t i = 0; i < e.args.size(); ++i)
+					a[i] = evaluate_as<T>(e.args[i]);
+				return N::elementary(e.kind, a);
+			}
+			else
+				throw runtime_error(function_key(e.kind) + ": not available in " + N::name() + " mode");
+		case t_interp:
+			if constexpr (requires (const Table& t, const T x) { N::interpolate(t, x); })
+				return N::interpolate(symbols.get_table(e.args[0].name), evaluate_as<T>(e.args[1]));
+			else
+				throw runtime_error(interpkey + ": not available in " + N::name() + " mode");
+		case t_ncr:
+		case t_npr:
+		case t_multinomial:
+			if constexpr (requires (const vector<uint64_t>& a) { N::combinations(e.kind, a); }) {
+				vector<uint64_t> a;
+				for (const Expr& x : e.args)
+					a.push_back(N::natural(e.kind, evaluate_as<T>(x)));
+				return N::combinations(e.kind, a);
+			}
+			else
+				throw runtime_error(function_key(e.kind) + ": not available in " + N::name() + " mode");
+		default:
+			throw runtime_error(function_key(e.kind) + ": not available in " + N::name() + " mode");
+	}
+}
+
+template<> double evaluate_as<double>(const Expr& e) { return evaluate(e); }
+
+// declare a variable called 'name' with the initial value 'expression'
+template<class T> T declaration(Token_stream& ts, const bool constant) {
+	const Token t = ts.get();
+	if (t.kind != t_name)
+		throw runtime_error("name expected in declaration");
+
+	if (const Token t2 = ts.get(); t2.kind != '=')
+		throw runtime_error("'=' missing in declaration of " + t.name);
+	const T d = evaluate_as<T>(conditional_expression(ts));
+	symbols.define_name(t.name, Numeric<T>::stored(d), constant);
+	return d;
+}
+
+// declare a formula called 'name' that keeps 'expression' unevaluated
+Expr formula_declaration(Token_stream& ts) {
+	const Token t = ts.get();
+	if (t.kind != t_name)
+		throw runtime_error("name expected in declaration");
+
+	if (const Token t2 = ts.get(); t2.kind != '=')
+		throw runtime_error("'=' missing in declaration of " + t.name);
+	const Expr source = conditional_expression(ts);
+	const Expr e = folds_constants() ? simplify(source) : source;
+	symbols.define_formula(t.name, source, e);
+	return e;
+}
+
+// whether the declaration that follows is of a table, leaving its tokens to be read again
+bool declares_table(Token_stream& ts) {
+	const Token t = ts.get();
+	if (t.kind != t_name) {
+		ts.putback(t);
+		return false;
+	}
+	const Token t2 = ts.get();
+	if (t2.kind != '=') {
+		ts.putback(t2);
+		ts.putback(t);
+		return false;
+	}
+	const Token t3 = ts.get();
+	ts.putback(t3);
+	ts.putback(t2);
+	ts.putback(t);
+	return t3.kind == t_table;
+}
+
+// read the breakpoints of a table from the file at path, an x and a y on each line separated
+// by ',' or spaces; empty lines and lines starting with '#' are skipped
+Table read_table(const string& path) {
+	ifstream is{path};
+	if (!is)
+		throw runtime_error(tablekey + ": cannot open " + path);
+	vector<double> x;
+	vector<double> y;
+	string line;
+	for (int n = 1; getline(is, line); ++n) {
+		ranges::replace(line, ',', ' ');
+		istringstream ls{line};
+		double a;
+		double b;
+		string rest;
+		if (!(ls >> rest) || rest[0] == '#')
+			continue;
+		ls.seekg(0);
+		if (!(ls >> a >> b) || ls >> rest)
+			throw runtime_error(path + ":" + to_string(n) + ": an x and a y expected");
+		x.push_back(a);
+		y.push_back(b);
+	}
+	return Table{std::move(x), std::move(y)};
+}
+
+// declare a table called 'name' from table("file") or table(x1, y1, x2, y2, ...), which
+// cannot be changed afterwards; return its description
+string table_declaration(Token_stream& ts) {
+	const Token t = ts.get();
+	ts.get();										// '=' and 'table', seen by declares_table
+	ts.get();
+
+	shared_ptr<const Table> table;
+	const Token t2 = ts.get();
+	const Token t3 = ts.get();
+	if (t2.kind == '(' && t3.kind == t_string) {
+		if (const Token t4 = ts.get(); t4.kind != ')')
+			throw runtime_error(tablekey + ": ')' expected");
+		const Token t5 = ts.get();					// read past the statement, as expression() does, for clean_up
+		ts.putback(t5);
+		table = make_shared<const Table>(read_table(t3.name));
+	}
+	else {
+		ts.putback(t3);
+		ts.putback(t2);
+		const vector<Expr> args = arguments(ts, tablekey, 2, any_number);
+		const Token t4 = ts.get();
+		ts.putback(t4);
+		if (args.size() % 2 != 0)
+			throw runtime_error(tablekey + ": pairs of x and y expected");
+		vector<double> x;
+		vector<double> y;
+		for (size_t i = 0; i < args.size(); i += 2) {
+			x.push_back(evaluate(args[i]));
+			y.push_back(evaluate(args[i+1]));
+		}
+		table = make_shared<const Table>(std::move(x), std::move(y));
+	}
+	ostringstream os;
+	os << *table;
+	symbols.define_table(t.name, std::move(table));
+	return os.str();
+}
+
+// give new value to named variable
+template<class T> T assignment(Token_stream& ts) {
+	const Token t = ts.get();
+	const string var_name = t.name;
+
+	if (!symbols.is_declared(var_name))
+		throw runtime_error(var_name + " has not been declared");
+
+	ts.get();								// skip the '='
+	const T d = evaluate_as<T>(conditional_expression(ts));
+	symbols.set_value(var_name, Numeric<T>::stored(d));
+	return d;
+}
+
+// deal with 'let'
+template<class T> T statement(Token_stream& ts) {
+	switch (const Token t = ts.get(); t.kind) {
+		case t_const:
+			return declaration<T>(ts, true);
+		case t_decl:
+			return declaration<T>(ts, false);
+		case t_name: {
+			const Token t2 = ts.get();
+			ts.putback(t2);				// need to rollback tokens to be usable
+			ts.putback(t);
+
+			if (t2.kind == t_assign)
+				return assignment<T>(ts);
+			break;
+		}
+		default:
+			ts.putback(t);
+	}
+	return evaluate_as<T>(conditional_expression(ts));
+}
+
+// switch the arithmetic used for calculations
+void set_mode(Token_stream& ts) {
+	const Token t = ts.get();
+	if (t.kind == t_name && t.name == floatkey)
+		mode = Mode::floating;
+	else if (t.kind == t_name && t.name == singlekey)
+		mode = Mode::single;
+	else if (t.kind == t_name && t.name == extendedkey)
+		mode = Mode::extended;
+	else if (t.kind == t_name && t.name == integerkey)
+		mode = Mode::integer;
+	else if (t.kind == t_name && t.name == exactkey)
+		mode = Mode::exact;
+	else if (t.kind == t_name && t.name == rationalkey)
+		mode = Mode::rational;
+	else if (t.kind == t_name && t.name == fixedkey) {
+		if (const Token digits = ts.get(); digits.kind == t_number) {
+			if (digits.value != trunc(digits.value) || digits.value < 0 || digits.value > max_fixed_scale)
+				throw runtime_error(fixedkey + ": number of digits from 0 to " + to_string(max_fixed_scale) + " expected");
+			fixed_scale = static_cast<int>(digits.value);
+		}
+		else
+			ts.putback(digits);
+		mode = Mode::fixed;
+	}
+	else if (t.kind == t_name && t.name == complexkey)
+		mode = Mode::complex;
+	else if (t.kind == t_name && t.name == modularkey) {
+		const Token m = ts.get();
+		const bool digits = m.kind == t_number && ranges::all_of(m.name, [](const char c) { return isdigit(c); });
+		if (!digits || m.name.size() > 19 || stoull(m.name) < 1 || stoull(m.name) >= uint64_t{1} << 63)
+			throw runtime_error(modularkey + ": modulus from 1 to 2^63 expected");
+		modular_modulus = stoull(m.name);
+		mode = Mode::modular;
+	}
+	else
+		throw runtime_error(modekey + ": '" + floatkey + "', '" + singlekey + "', '" + extendedkey
+			+ "', '" + integerkey + "', '" + exactkey + "', '" + rationalkey + "', '" + fixedkey
+			+ "', '" + complexkey + "' or '" + modularkey + "' expected");
+}
+
+// switch to floating point arithmetic of the given bits, doubles serve up to 53
+void set_precision(const double bits) {
+	if (bits != trunc(bits) || bits < 1 || bits > max_precision)
+		throw runtime_error(precisionkey + ": number of bits from 1 to " + to_string(max_precision) + " expected");
+	if (bits <= 53)
+		mode = Mode::floating;
+	else {
+		mode = Mode::precise;
+		precision_bits = static_cast<int64_t>(bits);
+	}
+}
+
+// switch to the floating point arithmetic called s
+void set_precision(const string& s) {
+	if (s == f32key)
+		mode = Mode::single;
+	else if (s == f64key)
+		mode = Mode::floating;
+	else if (s == mixedkey)
+		mode = Mode::mixed;
+	else
+		throw runtime_error(precisionkey + ": '" + f32key + "', '" + f64key + "', '" + mixedkey
+			+ "' or a number of bits expected");
+}
+
+void set_precision(Token_stream& ts) {
+	const Token t = ts.get();
+	if (t.kind == t_number)
+		set_precision(t.value);
+	else
+		set_precision(t.kind == t_name ? t.name : string{});
+}
+
+// use the approximations for "approx", or "approx:e" with e their maximum relative error
+void set_fast_math(const string& s) {
+	double e = default_approx_error;
+	if (s.starts_with(approxkey + ":")) {
+		const string value = s.substr(approxkey.size() + 1);
+		char* end = nullptr;
+		e = strtod(value.c_str(), &end);
+		if (value.empty() || end != value.c_str() + value.size())
+			throw runtime_error(fastmathkey + ": bad number " + value);
+	}
+	else if (s != approxkey)
+		throw runtime_error(fastmathkey + ": '" + approxkey + "' or '" + approxkey + ":e' expected");
+	if (!(e >= min_approx_error && e <= max_approx_error)) {
+		ostringstream os;
+		os << fastmathkey << ": maximum relative error from " << min_approx_error << " to " << max_approx_error << " expected";
+		throw runtime_error(os.str());
+	}
+	fast_math = make_unique<Approx_math>(e);
+}
+
+// limit parallel work to the number of threads in s
+void set_threads(const string& s) {
+	int n = 0;
+	const auto [end, error] = from_chars(s.data(), s.data() + s.size(), n);
+	if (error != errc{} || end != s.data() + s.size() || n < 1)
+		throw runtime_error(threadskey + ": positive integer expected");
+	max_threads = n;
+}
+
+// move to start of next expression
 void clean_up(Token_stream& ts) {
 	ts.ignore(t_print);
 }
@@ -540,10 +6217,38 @@ void print_help() {
 	<< "\t\tEnter '" << quitkey << "' or '" << t_quit << "' to exit the program.\n"
 	<< "\t\tEnter '" << t_print << "' or a new line to print the results.\n"
 	<< "\t\tSupported operands: '*', '/', '%', '!', '+', '-', '=' (assignment).\n"
+	<< "\t\tn! is gamma(n+1) for fractions, so that 0.5! = 0.886227.\n"
+	<< "\t\tComparisons '<', '<=', '>', '>=', '==', '!=' give 1 if they hold, otherwise 0;\n"
+	<< "\t\t'n!=m' compares, write 'n! == m' for a factorial.\n"
+	<< "\t\tc ? a : b is a if c is not 0, otherwise b, and only evaluates the one chosen.\n"
 	<< "\t\tBrackets and braces can be used to group expressions: '4*(2+3)'.\n"
 	<< "\n\tFunctions:\n"
 	<< "\t\t" << sqrtkey << "(n)\t\t\tsquare root of n.\n"
 	<< "\t\t" << powkey << "(n, e)\t\te power of n.\n"
+	<< "\t\t" << powmodkey << "(n, e, m)\te power of n modulo m, for integers.\n"
+	<< "\t\t" << expkey << "(n), " << logkey << "(n)\t\texponential and natural logarithm of n.\n"
+	<< "\t\t" << sinkey << "(n), " << coskey << "(n), " << tankey << "(n)\tsine, cosine and tangent of n radians.\n"
+	<< "\t\t" << atan2key << "(y, x)\t\tangle of the point (x, y) in radians, from -pi to pi.\n"
+	<< "\t\t" << tanhkey << "(n), " << erfkey << "(n)\t\thyperbolic tangent and error function of n.\n"
+	<< "\t\t" << interpkey << "(t, x)\t\tvalue at x of table t, linear between breakpoints.\n"
+	<< "\t\t" << ifkey << "(c, a, b)\t\tc ? a : b.\n"
+	<< "\t\t" << isprimekey << "(n)\t\t1 if n is prime, otherwise 0.\n"
+	<< "\t\t" << nextprimekey << "(n)\t\tsmallest prime above n.\n"
+	<< "\t\t" << primepikey << "(n)\t\tnumber of primes up to n.\n"
+	<< "\t\t" << factorkey << "(n)\t\tsmallest prime factor of n, and all of them in a note.\n"
+	<< "\t\t" << ncrkey << "(n, r)\t\tnumber of ways to choose r of n items.\n"
+	<< "\t\t" << nprkey << "(n, r)\t\tnumber of ways to arrange r of n items in order.\n"
+	<< "\t\t" << multinomialkey << "(a, b, ...)\tnumber of ways to split a+b+... items into groups of a, b, ...\n"
+	<< "\t\t" << derivkey << "(expr, x)\tderivative of expr with respect to variable x.\n"
+	<< "\t\t" << solvekey << "(expr, x, g)\tvalue of x near g for which expr is 0.\n"
+	<< "\t\t" << solvekey << "(expr, x, a, b)\tvalue of x between a and b for which expr is 0.\n"
+	<< "\t\t" << integratekey << "(expr, x, a, b)\tintegral of expr over x from a to b.\n"
+	<< "\t\t" << minimizekey << "(expr, x, y, a, b)\tminimum of expr over x and y, starting from x=a, y=b.\n"
+	<< "\t\t" << odesolvekey << "(f, g, t, y, z, t0, a, b, t1)\ty at t1 for y'=f, z'=g with y=a, z=b at t0.\n"
+	<< "\t\t" << randkey << "()\t\t\tuniform random number in [0, 1).\n"
+	<< "\t\t" << randnkey << "()\t\t\tnormal random number with mean 0 and standard deviation 1.\n"
+	<< "\t\t" << seedkey << "(n)\t\t\trestart the random numbers from seed n.\n"
+	<< "\t\t" << montecarlokey << "(expr, n)\tmean of n samples of expr, which uses random numbers.\n"
 	<< "\n\tUser Variables:\n"
 	<< "\t\tVariables names must be composed of alphanumerical characters and '_',\n"
 	<< "\t\tand must start with an alphabetical character: 'a_var3', 'X', or 'y2'.\n"
@@ -551,7 +6256,30 @@ void print_help() {
 	<< "\t\t" << t_decl << " var = expr\t\t\twith evaluation value of expression expr.\n"
 	<< "\t\t" << constkey << " var = expr\t\tdeclare and initialize a constant named var.\n"
 	<< "\t\tvar " << t_assign << " expr\t\t\t\tassign new value to previously declared variable var.\n"
+	<< "\t\t" << fnkey << " f = expr\t\t\tdeclare a formula f, re-evaluated from expr each time f is used.\n"
+	<< "\t\t" << fnkey << " df = " << derivkey << "(f, x)\t\tdeclare the formula df as the derivative of f.\n"
+	<< "\t\t" << declkey << " t = " << tablekey << "(x1, y1, x2, y2, ...)\tdeclare a table t of breakpoints with increasing x.\n"
+	<< "\t\t" << declkey << " t = " << tablekey << "(\"file\")\tread the breakpoints of t from file, 'x, y' on each line.\n"
 	<< "\t\tEnter '" << symbkey << "' to see all variables in the program.\n"
+	<< "\n\tModes:\n"
+	<< "\t\t" << modekey << " " << integerkey << "\t\t64 bit integer arithmetic, '/' truncates and overflow is an error.\n"
+	<< "\t\t" << modekey << " " << exactkey << "\t\t\texact arithmetic on integers of any size.\n"
+	<< "\t\t" << modekey << " " << rationalkey << "\t\texact arithmetic on fractions, '/' gives e.g. 1/3.\n"
+	<< "\t\t" << modekey << " " << fixedkey << " n\t\tdecimals with n digits after the point (" << fixed_scale
+		<< " if omitted), rounded half to even.\n"
+	<< "\t\t" << modekey << " " << complexkey << "\t\tcomplex floating point arithmetic, i is the imaginary unit.\n"
+	<< "\t\t" << modekey << " " << modularkey << " m\t\tinteger arithmetic modulo m, '/' multiplies by the inverse.\n"
+	<< "\t\t" << modekey << " " << floatkey << "\t\t\tfloating point arithmetic (the default).\n"
+	<< "\t\t" << modekey << " " << singlekey << "\t\t\tsingle precision floating point arithmetic.\n"
+	<< "\t\t" << modekey << " " << extendedkey << "\t\textended precision (long double) floating point arithmetic.\n"
+	<< "\t\t" << precisionkey << " n\t\tfloating point arithmetic with n bits, doubles up to 53.\n"
+	<< "\t\t" << precisionkey << " " << f32key << "|" << f64key << "\t\tsingle or double precision floating point arithmetic.\n"
+	<< "\t\t" << precisionkey << " " << mixedkey << "\t\tdouble precision, but " << integratekey << " and "
+		<< montecarlokey << " evaluate in single.\n"
+	<< "\t\tStarted with --" << fastmathkey << "=" << approxkey << ":e, " << powkey << ", " << expkey << ", " << logkey
+		<< ", " << sinkey << ", " << coskey << " and " << tankey << " are approximated\n"
+	<< "\t\tin double precision to within relative error e (" << default_approx_error << " if omitted).\n"
+	<< "\t\tStarted with --" << threadskey << "=n, parallel work uses at most n threads.\n"
 	<< "\n\tPredefined Variables:\n"
 	<< "\t\tpi\t\t3.1415926535 (constant)\n"
 	<< "\t\te\t\t2.7182818284 (constant)\n"
@@ -567,6 +6295,8 @@ void calculate(Token_stream& ts) {
 	while(cin) {
 		try {
 			cout << prompt;
+			note.clear();
+			approximated = false;
 			Token t = ts.get();
 			while (t.kind == t_print)						// first discard all 'prints'
 				t = ts.get();
@@ -580,9 +6310,64 @@ void calculate(Token_stream& ts) {
 				case t_symbols:
 					symbols.print();
 					break;
+				case t_fn:
+					cout << result << formula_declaration(ts) << "\n";
+					break;
+				case t_mode:
+					set_mode(ts);
+					break;
+				case t_precision:
+					set_precision(ts);
+					break;
+				case t_decl:
+				case t_const:
+					if (declares_table(ts)) {
+						cout << result << table_declaration(ts) << "\n";
+						break;
+					}
+					[[fallthrough]];
 				default:									// if no commands, do and show calc
 					ts.putback(t);
-					cout << result << statement(ts) << "\n";
+					switch (mode) {
+						case Mode::single:
+							cout << result << statement<float>(ts) << "\n";
+							break;
+						case Mode::floating:
+						case Mode::mixed:
+							cout << result << statement<double>(ts) << "\n";
+							break;
+						case Mode::extended:
+							cout << result << statement<long double>(ts) << "\n";
+							break;
+						case Mode::integer:
+							cout << result << statement<Checked>(ts) << "\n";
+							break;
+						case Mode::exact:
+							cout << result << statement<Bigint>(ts) << "\n";
+							break;
+						case Mode::rational:
+							cout << result << statement<Rational>(ts) << "\n";
+							break;
+						case Mode::fixed:
+							cout << result << statement<Fixed>(ts) << "\n";
+							break;
+						case Mode::complex:
+							cout << result << format(statement<Complex>(ts)) << "\n";
+							break;
+						case Mode::modular:
+							cout << result << statement<Modular>(ts) << "\n";
+							break;
+						case Mode::precise:
+							cout << result << statement<Bigfloat>(ts) << "\n";
+							break;
+					}
+					if (approximated) {
+						ostringstream os;
+						os << fastmathkey << ": approximate functions, each within relative error " << fast_math->max_error;
+						note += (note.empty() ? "" : "\n") + os.str();
+					}
+					if (!note.empty())
+						cout << note << "\n";
 			}
 		}
 		catch (exception& e) {
@@ -592,11 +6377,33 @@ void calculate(Token_stream& ts) {
 	}
 }
 
-int main()
+int main(int argc, char* argv[])
 try
 {
 	Token_stream ts {cin}; // construct Token_stream using cin as the input stream
 
+	const string option = "--" + precisionkey + "=";
+	const string fast_math_option = "--" + fastmathkey + "=";
+	const string threads_option = "--" + threadskey + "=";
+	for (int i = 1; i < argc; ++i) {
+		const string arg = argv[i];
+		if (arg.starts_with(fast_math_option)) {
+			set_fast_math(arg.substr(fast_math_option.size()));
+			continue;
+		}
+		if (arg.starts_with(threads_option)) {
+			set_threads(arg.substr(threads_option.size()));
+			continue;
+		}
+		if (!arg.starts_with(option))
+			throw runtime_error("unknown option " + arg);
+		const string value = arg.substr(option.size());
+		if (!value.empty() && ranges::all_of(value, [](const char c) { return isdigit(c); }))
+			set_precision(stod(value));
+		else
+			set_precision(value);
+	}
+
 	// predefine names:
 	symbols.define_name("pi", 3.1415926535, true);
 	symbols.define_name("e", 2.7182818284, true);
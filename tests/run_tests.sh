@@ -0,0 +1,30 @@
+#!/bin/sh
+# Runs each tests/NAME.in through the calculator and compares what it writes, errors
+# included, with tests/NAME.out. If tests/NAME.args exists, each of its lines is a set
+# of command line options and every run must give the same output.
+# Inputs must end with 'q', as the calculator waits for more input at the end of a file.
+#
+# usage: run_tests.sh path/to/calculator
+
+calculator=${1:?usage: run_tests.sh path/to/calculator}
+dir=$(dirname "$0")
+failed=0
+
+for input in "$dir"/*.in; do
+	name=${input%.in}
+	if [ -f "$name.args" ]; then
+		runs=$(cat "$name.args")
+	else
+		runs=""
+	fi
+	echo "$runs" | while IFS= read -r options; do
+		# shellcheck disable=SC2086
+		if ! timeout 60 "$calculator" $options < "$input" 2>&1 | diff -u "$name.out" - > /dev/null; then
+			echo "FAIL: $(basename "$name") $options"
+			timeout 60 "$calculator" $options < "$input" 2>&1 | diff -u "$name.out" -
+			exit 1
+		fi
+	done || failed=1
+done
+
+exit $failed